@@ -266,9 +266,11 @@ freplaceFileComponent(string** dest, const string* fullPath, const string* fileN
 		return;
 	}
 
-	string* basePath = str_Slice(fullPath, 0, lastSlash + 1 - str_String(fullPath));
-	string* newFullPath = str_Concat(basePath, fileName);
-	str_Free(basePath);
+	string_view basePath = strview_Create(fullPath, 0, lastSlash + 1 - str_String(fullPath));
+	string_view fileNameView = strview_Whole(fileName);
+	string* newFullPath = strview_Concat(&basePath, &fileNameView);
+	strview_Free(&basePath);
+	strview_Free(&fileNameView);
 
 	string* fixedPath = fcanonicalizePath(newFullPath);
 	str_Free(newFullPath);
@@ -27,6 +27,7 @@ typedef struct Map {
 	free_t valueFree;
 	set_t* set;
 	intptr_t userData;
+	mem_arena_t* arena;
 } map_t;
 
 #include "map.h"
@@ -67,7 +68,8 @@ keyvalueFree(intptr_t userData, intptr_t element) {
 	keyvalue_t* kv = (keyvalue_t*) element;
 	map->keyFree(map->userData, kv->key);
 	map->valueFree(map->userData, kv->value);
-	mem_Free(kv);
+	if (map->arena == NULL)
+		mem_Free(kv);
 }
 
 static void
@@ -93,6 +95,21 @@ map_Create(equals_t keyEquals, hash_t keyHash, free_t keyFree, free_t valueFree)
 	map->keyHash = keyHash;
 	map->keyFree = keyFree;
 	map->valueFree = valueFree;
+	map->arena = NULL;
+	set_SetUserData(map->set, (intptr_t) map);
+
+	return map;
+}
+
+extern map_t*
+map_CreateArena(mem_arena_t* arena, equals_t keyEquals, hash_t keyHash, free_t keyFree, free_t valueFree) {
+	map_t* map = (map_t*) mem_ArenaAlloc(arena, sizeof(map_t));
+	map->set = set_CreateArena(arena, keyvalueEquals, keyvalueHash, keyvalueFree);
+	map->keyEquals = keyEquals;
+	map->keyHash = keyHash;
+	map->keyFree = keyFree;
+	map->valueFree = valueFree;
+	map->arena = arena;
 	set_SetUserData(map->set, (intptr_t) map);
 
 	return map;
@@ -100,7 +117,8 @@ map_Create(equals_t keyEquals, hash_t keyHash, free_t keyFree, free_t valueFree)
 
 extern map_t*
 map_CreateSubMap(map_t* map) {
-	map_t* subMap = (map_t*) mem_Alloc(sizeof(map_t));
+	map_t* subMap = (map_t*) (map->arena != NULL ? mem_ArenaAlloc(map->arena, sizeof(map_t)) : mem_Alloc(sizeof(map_t)));
+	subMap->arena = map->arena;
 	subMap->set = set_CreateSubSet(map->set);
 	subMap->keyEquals = map->keyEquals;
 	subMap->keyHash = map->keyHash;
@@ -119,12 +137,14 @@ map_Clear(map_t* map) {
 extern void
 map_Free(map_t* map) {
 	set_Free(map->set);
-	mem_Free(map);
+	if (map->arena == NULL)
+		mem_Free(map);
 }
 
 extern void
 map_Insert(map_t* map, intptr_t key, intptr_t value) {
-	keyvalue_t* kv = (keyvalue_t*) mem_Alloc(sizeof(keyvalue_t));
+	keyvalue_t* kv = (keyvalue_t*) (map->arena != NULL ? mem_ArenaAlloc(map->arena, sizeof(keyvalue_t))
+	                                                   : mem_Alloc(sizeof(keyvalue_t)));
 	kv->key = key;
 	kv->value = value;
 	set_Insert(map->set, (intptr_t) kv);
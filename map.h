@@ -21,6 +21,7 @@
 #include <stdbool.h>
 #include <stdio.h>
 
+#include "mem.h"
 #include "protos.h"
 
 #ifndef IN_MAP_C_
@@ -40,6 +41,10 @@ map_CreateDebug(equals_t keyEquals, hash_t keyHash, free_t keyFree, free_t value
 map_Create(equals_t keyEquals, hash_t keyHash, free_t keyFree, free_t valueFree);
 #endif
 
+/* Create a map whose control block, hash lists and key/value nodes are allocated from an arena */
+extern map_t*
+map_CreateArena(mem_arena_t* arena, equals_t keyEquals, hash_t keyHash, free_t keyFree, free_t valueFree);
+
 extern map_t*
 map_CreateSubMap(map_t* map);
 
@@ -16,13 +16,24 @@
     along with ASMotor.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+// for mremap
+#define _GNU_SOURCE
+#endif
+
 #include <assert.h>
 #include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 #include "lists.h"
 #include "mem.h"
+#include "str.h"
 #include "util.h"
 
 #if __STDC_VERSION__ > 201112L
@@ -33,33 +44,1122 @@
 #endif
 #define HEADERSIZE ((sizeof(SMemoryChunk) + (ALIGN - 1)) & -ALIGN)
 
-typedef struct MemoryChunk {
-	list_Data(struct MemoryChunk);
-	size_t size;
-#if defined(_DEBUG)
-	const char* filename;
-	int lineNumber;
+// Debug builds surround every block with red zones that are verified when the block is freed or reallocated
+#if defined(_DEBUG)
+#define REDZONE_SIZE    16U
+#define REDZONE_PATTERN 0xFDU
+#else
+#define REDZONE_SIZE 0U
+#endif
+
+#define BLOCK_OFFSET   (HEADERSIZE + REDZONE_SIZE)
+#define BLOCK_OVERHEAD (HEADERSIZE + 2 * REDZONE_SIZE)
+
+#if defined(ASMOTOR_PROFILE_MEMORY) && defined(_DEBUG) && !defined(ASMOTOR_INLINE_MEMORY) && !defined(ASMOTOR_FAKE_ALLOC)
+#define PROFILE_ALLOC
+#endif
+
+typedef struct MemoryChunk {
+#if defined(_DEBUG)
+	list_Data(struct MemoryChunk);
+#endif
+	size_t size;
+#if defined(_DEBUG)
+	const char* filename;
+	int lineNumber;
+#endif
+#if defined(PROFILE_ALLOC)
+	struct AllocationSite* site;
+	uint64_t birth;
+#endif
+} SMemoryChunk;
+
+#if defined(ASMOTOR_THREADSAFE_MEMORY) && defined(ASMOTOR_FAKE_ALLOC)
+#error "ASMOTOR_THREADSAFE_MEMORY cannot be combined with ASMOTOR_FAKE_ALLOC"
+#endif
+
+#if defined(ASMOTOR_THREADSAFE_MEMORY)
+// Spin locks guard the shared allocator state. The critical sections are a handful of pointer updates, and a
+// zero initialized lock is unlocked, so no runtime initialization is needed.
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+typedef volatile long mem_lock_t;
+#define LOCK_EXCHANGE(lock, value) _InterlockedExchange(lock, value)
+#define LOCK_CLEAR(lock)           _InterlockedExchange(lock, 0)
+#define LOCK_PEEK(lock)            (*(lock))
+#else
+typedef volatile int mem_lock_t;
+#define LOCK_EXCHANGE(lock, value) __sync_lock_test_and_set(lock, value)
+#define LOCK_CLEAR(lock)           __sync_lock_release(lock)
+#define LOCK_PEEK(lock)            __atomic_load_n(lock, __ATOMIC_RELAXED)
+#endif
+
+#define CACHE_LINE_SIZE 64U
+
+INLINE void
+lock_Acquire(mem_lock_t* lock) {
+	while (LOCK_EXCHANGE(lock, 1) != 0) {
+		while (LOCK_PEEK(lock) != 0) {
+		}
+	}
+}
+
+INLINE void
+lock_Release(mem_lock_t* lock) {
+	LOCK_CLEAR(lock);
+}
+#endif
+
+#if defined(_DEBUG) && !defined(ASMOTOR_INLINE_MEMORY) && !defined(ASMOTOR_FAKE_ALLOC)
+// The live allocation registry, only kept in debug builds for mem_ShowLeaks. In thread safe mode it is split into
+// shards, selected by chunk address, each with its own lock and cache line so threads rarely contend for the same
+// list.
+
+typedef struct {
+#if defined(ASMOTOR_THREADSAFE_MEMORY)
+	SMemoryChunk* list;
+	mem_lock_t lock;
+	char padding[CACHE_LINE_SIZE - sizeof(mem_lock_t) - sizeof(SMemoryChunk*)];
+#else
+	SMemoryChunk* list;
+#endif
+} SRegistryShard;
+
+#if defined(ASMOTOR_THREADSAFE_MEMORY)
+#define REGISTRY_SHARDS 16U
+
+#define registry_Lock(shard)   lock_Acquire(&(shard)->lock)
+#define registry_Unlock(shard) lock_Release(&(shard)->lock)
+
+#define registryShard(chunk) (&g_memoryShards[((uintptr_t) (chunk) / CACHE_LINE_SIZE) % REGISTRY_SHARDS])
+#else
+#define REGISTRY_SHARDS 1U
+
+#define registry_Lock(shard)
+#define registry_Unlock(shard)
+
+#define registryShard(chunk) (&g_memoryShards[0])
+#endif
+
+static SRegistryShard g_memoryShards[REGISTRY_SHARDS];
+
+// Allocation sites are keyed by the __FILE__ pointer and line number passed down by the debug entry points
+INLINE size_t
+siteHash(const char* filename, int lineNumber) {
+	uint64_t hash = ((uint64_t) (uintptr_t) filename ^ (uint64_t) lineNumber) * 0x9E3779B97F4A7C15ULL;
+	return (size_t) (hash >> 32U);
+}
+
+INLINE void
+registerChunk(SMemoryChunk* chunk) {
+	SRegistryShard* shard = registryShard(chunk);
+	registry_Lock(shard);
+	list_Insert(shard->list, chunk);
+	registry_Unlock(shard);
+}
+
+INLINE void
+unregisterChunk(SMemoryChunk* chunk) {
+	SRegistryShard* shard = registryShard(chunk);
+	registry_Lock(shard);
+	list_Remove(shard->list, chunk);
+	registry_Unlock(shard);
+}
+#elif !defined(ASMOTOR_INLINE_MEMORY) && !defined(ASMOTOR_FAKE_ALLOC)
+INLINE void
+registerChunk(SMemoryChunk* chunk) {}
+
+INLINE void
+unregisterChunk(SMemoryChunk* chunk) {}
+#endif
+
+#if !defined(ASMOTOR_INLINE_MEMORY)
+// Global allocation statistics, O(1) to maintain
+
+static size_t g_liveBytes = 0;
+static size_t g_peakBytes = 0;
+static size_t g_liveAllocations = 0;
+static uint64_t g_totalAllocations = 0;
+
+#if defined(ASMOTOR_THREADSAFE_MEMORY) && defined(_MSC_VER)
+#define ATOMIC_ADD(p, value) \
+	((size_t) _InterlockedExchangeAdd64((volatile __int64*) (p), (__int64) (value)) + (value))
+#define ATOMIC_ADD64(p, value)                   ATOMIC_ADD(p, value)
+#define ATOMIC_LOAD(p)                           (*(p))
+#define ATOMIC_COMPARE_EXCHANGE(p, expected, to) \
+	(_InterlockedCompareExchange64((volatile __int64*) (p), (__int64) (to), (__int64) (expected)) == (__int64) (expected))
+#elif defined(ASMOTOR_THREADSAFE_MEMORY)
+#define ATOMIC_ADD(p, value)                     __atomic_add_fetch(p, value, __ATOMIC_RELAXED)
+#define ATOMIC_ADD64(p, value)                   __atomic_add_fetch(p, value, __ATOMIC_RELAXED)
+#define ATOMIC_LOAD(p)                           __atomic_load_n(p, __ATOMIC_RELAXED)
+#define ATOMIC_COMPARE_EXCHANGE(p, expected, to) \
+	__atomic_compare_exchange_n(p, &(expected), to, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)
+#else
+#define ATOMIC_ADD(p, value)                     (*(p) += (value))
+#define ATOMIC_ADD64(p, value)                   (*(p) += (value))
+#define ATOMIC_LOAD(p)                           (*(p))
+#define ATOMIC_COMPARE_EXCHANGE(p, expected, to) (*(p) = (to), true)
+#endif
+
+INLINE void
+stats_Grow(size_t size) {
+	size_t live = ATOMIC_ADD(&g_liveBytes, size);
+	size_t peak = ATOMIC_LOAD(&g_peakBytes);
+	while (live > peak && !ATOMIC_COMPARE_EXCHANGE(&g_peakBytes, peak, live)) {
+	}
+}
+
+INLINE void
+stats_Alloc(size_t size) {
+	stats_Grow(size);
+	ATOMIC_ADD(&g_liveAllocations, 1);
+	ATOMIC_ADD64(&g_totalAllocations, 1);
+}
+
+INLINE void
+stats_Free(size_t size) {
+	ATOMIC_ADD(&g_liveBytes, (size_t) 0 - size);
+	ATOMIC_ADD(&g_liveAllocations, (size_t) 0 - 1);
+}
+
+void
+mem_GetStats(mem_stats_t* stats) {
+	stats->liveBytes = ATOMIC_LOAD(&g_liveBytes);
+	stats->peakBytes = ATOMIC_LOAD(&g_peakBytes);
+	stats->liveAllocations = ATOMIC_LOAD(&g_liveAllocations);
+	stats->totalAllocations = ATOMIC_LOAD(&g_totalAllocations);
+}
+#endif
+
+#if defined(ASMOTOR_FAKE_ALLOC)
+// Bump allocator that never frees. Blocks are carved from chunks chained together as they fill up. Each block is
+// preceded by its size so mem_Realloc knows how much to copy, and the most recently allocated block can grow or
+// shrink in place.
+
+#define FAKE_CHUNK_SIZE (1024U * 1024U)
+#define FAKE_ROUND(size) (((size) + sizeof(size_t) - 1) & ~(sizeof(size_t) - 1))
+
+typedef struct FakeChunk {
+	struct FakeChunk* next;
+	size_t size;
+} SFakeChunk;
+
+#define FAKE_CHUNK_HEADERSIZE FAKE_ROUND(sizeof(SFakeChunk))
+
+static SFakeChunk* g_fakeChunks = NULL;
+static uint8_t* g_fakeMalloc = NULL;
+static uint8_t* g_fakeEnd = NULL;
+static size_t* g_fakeLastBlock = NULL;
+
+static size_t*
+fakeNewChunk(size_t blockSize) {
+	size_t chunkSize = FAKE_CHUNK_HEADERSIZE + (blockSize > FAKE_CHUNK_SIZE ? blockSize : FAKE_CHUNK_SIZE);
+	SFakeChunk* chunk = malloc(chunkSize);
+	if (chunk == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+
+	chunk->next = g_fakeChunks;
+	chunk->size = chunkSize;
+	g_fakeChunks = chunk;
+
+	uint8_t* block = (uint8_t*) chunk + FAKE_CHUNK_HEADERSIZE;
+	g_fakeEnd = (uint8_t*) chunk + chunkSize;
+	return (size_t*) block;
+}
+
+void*
+mem_AllocImpl(size_t size, const char* filename, int lineNumber) {
+	size_t blockSize = sizeof(size_t) + FAKE_ROUND(size);
+	size_t* block = (size_t*) g_fakeMalloc;
+	if (g_fakeMalloc == NULL || (size_t) (g_fakeEnd - g_fakeMalloc) < blockSize)
+		block = fakeNewChunk(blockSize);
+
+	*block = size;
+	g_fakeMalloc = (uint8_t*) block + blockSize;
+	g_fakeLastBlock = block;
+	stats_Alloc(size);
+	return block + 1;
+}
+
+void*
+mem_ReallocImpl(void* memory, size_t size, const char* filename, int lineNumber) {
+	if (memory == NULL)
+		return mem_AllocImpl(size, filename, lineNumber);
+
+	size_t* block = (size_t*) memory - 1;
+	size_t oldSize = *block;
+
+	if (block == g_fakeLastBlock && (size_t) (g_fakeEnd - (uint8_t*) memory) >= FAKE_ROUND(size)) {
+		*block = size;
+		g_fakeMalloc = (uint8_t*) memory + FAKE_ROUND(size);
+		// Only the growth is counted, the block is not a new allocation
+		if (size > oldSize)
+			stats_Grow(size - oldSize);
+		return memory;
+	}
+
+	if (size <= oldSize) {
+		*block = size;
+		return memory;
+	}
+
+	void* newMemory = mem_AllocImpl(size, filename, lineNumber);
+	memcpy(newMemory, memory, oldSize);
+	return newMemory;
+}
+#endif
+
+#if defined(PROFILE_ALLOC)
+// Per call site allocation profile. Lifetimes are measured in allocations made while the block was live and are
+// collected in a histogram with power of four buckets.
+
+#define PROFILE_BUCKETS 16U
+
+typedef struct AllocationSite {
+	const char* filename;
+	int lineNumber;
+	uint64_t allocations;
+	uint64_t bytes;
+	size_t liveBlocks;
+	size_t liveBytes;
+	size_t peakLiveBytes;
+	uint64_t lifetimes[PROFILE_BUCKETS];
+} SAllocationSite;
+
+static SAllocationSite** g_profileSites = NULL;
+static size_t g_profileCapacity = 0;
+static size_t g_profileCount = 0;
+static uint64_t g_profileClock = 0;
+
+static const char* g_profileFilename = NULL;
+static mem_profile_format_t g_profileFormat;
+
+#if defined(ASMOTOR_THREADSAFE_MEMORY)
+static mem_lock_t g_profileLock;
+#define profile_Lock()   lock_Acquire(&g_profileLock)
+#define profile_Unlock() lock_Release(&g_profileLock)
+#else
+#define profile_Lock()
+#define profile_Unlock()
+#endif
+
+static bool
+growProfileSites(void) {
+	size_t capacity = g_profileCapacity == 0 ? 256 : g_profileCapacity * 2;
+	SAllocationSite** sites = calloc(capacity, sizeof(SAllocationSite*));
+	if (sites == NULL)
+		return false;
+
+	for (size_t i = 0; i < g_profileCapacity; ++i) {
+		SAllocationSite* site = g_profileSites[i];
+		if (site != NULL) {
+			size_t index = siteHash(site->filename, site->lineNumber) & (capacity - 1);
+			while (sites[index] != NULL)
+				index = (index + 1) & (capacity - 1);
+			sites[index] = site;
+		}
+	}
+
+	free(g_profileSites);
+	g_profileSites = sites;
+	g_profileCapacity = capacity;
+	return true;
+}
+
+static SAllocationSite*
+findProfileSite(const char* filename, int lineNumber) {
+	if (g_profileCount * 2 >= g_profileCapacity && !growProfileSites())
+		return NULL;
+
+	size_t index = siteHash(filename, lineNumber) & (g_profileCapacity - 1);
+	while (g_profileSites[index] != NULL) {
+		SAllocationSite* site = g_profileSites[index];
+		if (site->filename == filename && site->lineNumber == lineNumber)
+			return site;
+		index = (index + 1) & (g_profileCapacity - 1);
+	}
+
+	SAllocationSite* site = calloc(1, sizeof(SAllocationSite));
+	if (site != NULL) {
+		site->filename = filename;
+		site->lineNumber = lineNumber;
+		g_profileSites[index] = site;
+		++g_profileCount;
+	}
+	return site;
+}
+
+static void
+profileAlloc(SMemoryChunk* chunk) {
+	profile_Lock();
+	SAllocationSite* site = findProfileSite(chunk->filename, chunk->lineNumber);
+	if (site != NULL) {
+		site->allocations += 1;
+		site->bytes += chunk->size;
+		site->liveBlocks += 1;
+		site->liveBytes += chunk->size;
+		if (site->liveBytes > site->peakLiveBytes)
+			site->peakLiveBytes = site->liveBytes;
+	}
+	chunk->site = site;
+	chunk->birth = ++g_profileClock;
+	profile_Unlock();
+}
+
+static void
+profileFree(SMemoryChunk* chunk) {
+	SAllocationSite* site = chunk->site;
+	if (site == NULL)
+		return;
+
+	profile_Lock();
+	uint64_t lifetime = g_profileClock - chunk->birth;
+	uint32_t bucket = 0;
+	while (lifetime >= 4 && bucket < PROFILE_BUCKETS - 1) {
+		lifetime >>= 2U;
+		++bucket;
+	}
+
+	site->liveBlocks -= 1;
+	site->liveBytes -= chunk->size;
+	site->lifetimes[bucket] += 1;
+	profile_Unlock();
+}
+
+static int
+compareSiteBytes(const void* lhs, const void* rhs) {
+	const SAllocationSite* site1 = *(const SAllocationSite* const*) lhs;
+	const SAllocationSite* site2 = *(const SAllocationSite* const*) rhs;
+	if (site1->bytes != site2->bytes)
+		return site1->bytes < site2->bytes ? 1 : -1;
+	return site1->lineNumber - site2->lineNumber;
+}
+
+static void
+writeJsonString(FILE* fileHandle, const char* str) {
+	fputc('"', fileHandle);
+	for (; *str != 0; ++str) {
+		if (*str == '"' || *str == '\\')
+			fputc('\\', fileHandle);
+		fputc(*str, fileHandle);
+	}
+	fputc('"', fileHandle);
+}
+
+static void
+writeProfileText(FILE* fileHandle, SAllocationSite** sites, size_t count) {
+	fprintf(fileHandle, "%12s %14s %12s %14s %14s  %s\n", "allocations", "bytes", "live blocks", "live bytes",
+	        "peak bytes", "site");
+	for (size_t i = 0; i < count; ++i) {
+		SAllocationSite* site = sites[i];
+		fprintf(fileHandle, "%12llu %14llu %12llu %14llu %14llu  %s:%d\n", (unsigned long long) site->allocations,
+		        (unsigned long long) site->bytes, (unsigned long long) site->liveBlocks,
+		        (unsigned long long) site->liveBytes, (unsigned long long) site->peakLiveBytes, site->filename,
+		        site->lineNumber);
+
+		fprintf(fileHandle, "%12s lifetimes:", "");
+		for (uint32_t bucket = 0; bucket < PROFILE_BUCKETS; ++bucket) {
+			if (site->lifetimes[bucket] != 0)
+				fprintf(fileHandle, " <4^%u:%llu", bucket + 1, (unsigned long long) site->lifetimes[bucket]);
+		}
+		fprintf(fileHandle, "\n");
+	}
+}
+
+static void
+writeProfileJson(FILE* fileHandle, SAllocationSite** sites, size_t count) {
+	fprintf(fileHandle, "{\"sites\":[");
+	for (size_t i = 0; i < count; ++i) {
+		SAllocationSite* site = sites[i];
+		fprintf(fileHandle, "%s\n{\"file\":", i == 0 ? "" : ",");
+		writeJsonString(fileHandle, site->filename);
+		fprintf(fileHandle,
+		        ",\"line\":%d,\"allocations\":%llu,\"bytes\":%llu,\"liveBlocks\":%llu,\"liveBytes\":%llu,"
+		        "\"peakLiveBytes\":%llu,\"lifetimes\":[",
+		        site->lineNumber, (unsigned long long) site->allocations, (unsigned long long) site->bytes,
+		        (unsigned long long) site->liveBlocks, (unsigned long long) site->liveBytes,
+		        (unsigned long long) site->peakLiveBytes);
+		for (uint32_t bucket = 0; bucket < PROFILE_BUCKETS; ++bucket) {
+			fprintf(fileHandle, "%s%llu", bucket == 0 ? "" : ",", (unsigned long long) site->lifetimes[bucket]);
+		}
+		fprintf(fileHandle, "]}");
+	}
+	fprintf(fileHandle, "\n]}\n");
+}
+
+void
+mem_WriteProfile(FILE* fileHandle, mem_profile_format_t format) {
+	profile_Lock();
+	SAllocationSite** sites = malloc((g_profileCount + 1) * sizeof(SAllocationSite*));
+	size_t count = 0;
+	if (sites != NULL) {
+		for (size_t i = 0; i < g_profileCapacity; ++i) {
+			if (g_profileSites[i] != NULL)
+				sites[count++] = g_profileSites[i];
+		}
+		qsort(sites, count, sizeof(SAllocationSite*), compareSiteBytes);
+
+		if (format == MEM_PROFILE_JSON)
+			writeProfileJson(fileHandle, sites, count);
+		else
+			writeProfileText(fileHandle, sites, count);
+
+		free(sites);
+	}
+	profile_Unlock();
+}
+
+static void
+writeProfileAtExit(void) {
+	FILE* fileHandle = fopen(g_profileFilename, "wt");
+	if (fileHandle != NULL) {
+		mem_WriteProfile(fileHandle, g_profileFormat);
+		fclose(fileHandle);
+	}
+}
+
+void
+mem_WriteProfileAtExit(const char* filename, mem_profile_format_t format) {
+	if (g_profileFilename == NULL)
+		atexit(writeProfileAtExit);
+
+	g_profileFilename = filename;
+	g_profileFormat = format;
+}
+#endif
+
+#if defined(ASMOTOR_TRACE_MEMORY) && !defined(ASMOTOR_INLINE_MEMORY) && !defined(ASMOTOR_FAKE_ALLOC)
+#define TRACE_ALLOC
+#endif
+
+#if defined(TRACE_ALLOC)
+// Allocation trace, replayed by tools/memreplay. The file starts with the 8 byte magic "ASMTRC01", followed by
+// records that each start with a type byte. All numbers are LEB128 varints, and block addresses are stored as the
+// zigzag encoded difference to the previous address in the trace.
+//
+//   'S' site index, line number, filename length, filename bytes
+//   'A' address, size, site index
+//   'R' old address, new address, size, site index
+//   'F' address
+//
+// Site records are written before the first event that refers to them. Site 0 is unknown, which is what release
+// builds record for every event.
+
+#define TRACE_MAGIC "ASMTRC01"
+
+static FILE* g_traceFile = NULL;
+static uintptr_t g_traceAddress = 0;
+
+#if defined(ASMOTOR_THREADSAFE_MEMORY)
+static mem_lock_t g_traceLock;
+#define trace_Lock()   lock_Acquire(&g_traceLock)
+#define trace_Unlock() lock_Release(&g_traceLock)
+#else
+#define trace_Lock()
+#define trace_Unlock()
+#endif
+
+static void
+traceNumber(uint64_t value) {
+	uint8_t bytes[10];
+	size_t count = 0;
+	while (value >= 0x80) {
+		bytes[count++] = (uint8_t) (value | 0x80U);
+		value >>= 7U;
+	}
+	bytes[count++] = (uint8_t) value;
+	fwrite(bytes, 1, count, g_traceFile);
+}
+
+static void
+traceAddress(void* memory) {
+	uintptr_t address = (uintptr_t) memory;
+	int64_t delta = (int64_t) (address - g_traceAddress);
+	traceNumber(((uint64_t) delta << 1U) ^ (uint64_t) (delta >> 63));
+	g_traceAddress = address;
+}
+
+#if defined(_DEBUG)
+typedef struct {
+	const char* filename;
+	int lineNumber;
+	uint32_t index;
+} STraceSite;
+
+static STraceSite* g_traceSites = NULL;
+static size_t g_traceSiteCapacity = 0;
+static uint32_t g_traceSiteCount = 0;
+
+static bool
+growTraceSites(void) {
+	size_t capacity = g_traceSiteCapacity == 0 ? 256 : g_traceSiteCapacity * 2;
+	STraceSite* sites = calloc(capacity, sizeof(STraceSite));
+	if (sites == NULL)
+		return false;
+
+	for (size_t i = 0; i < g_traceSiteCapacity; ++i) {
+		STraceSite* site = &g_traceSites[i];
+		if (site->filename != NULL) {
+			size_t index = siteHash(site->filename, site->lineNumber) & (capacity - 1);
+			while (sites[index].filename != NULL)
+				index = (index + 1) & (capacity - 1);
+			sites[index] = *site;
+		}
+	}
+
+	free(g_traceSites);
+	g_traceSites = sites;
+	g_traceSiteCapacity = capacity;
+	return true;
+}
+
+// Return the trace index of a site, writing its site record the first time it is seen
+static uint32_t
+traceSite(const char* filename, int lineNumber) {
+	if (filename == NULL || ((size_t) g_traceSiteCount * 2 >= g_traceSiteCapacity && !growTraceSites()))
+		return 0;
+
+	size_t index = siteHash(filename, lineNumber) & (g_traceSiteCapacity - 1);
+	while (g_traceSites[index].filename != NULL) {
+		STraceSite* site = &g_traceSites[index];
+		if (site->filename == filename && site->lineNumber == lineNumber)
+			return site->index;
+		index = (index + 1) & (g_traceSiteCapacity - 1);
+	}
+
+	STraceSite* site = &g_traceSites[index];
+	site->filename = filename;
+	site->lineNumber = lineNumber;
+	site->index = ++g_traceSiteCount;
+
+	size_t length = strlen(filename);
+	fputc('S', g_traceFile);
+	traceNumber(site->index);
+	traceNumber((uint64_t) lineNumber);
+	traceNumber(length);
+	fwrite(filename, 1, length, g_traceFile);
+	return site->index;
+}
+#else
+#define traceSite(filename, lineNumber) 0U
+#endif
+
+static void
+traceAlloc(void* oldMemory, void* memory, size_t size, const char* filename, int lineNumber) {
+	if (g_traceFile == NULL)
+		return;
+
+	trace_Lock();
+	if (g_traceFile != NULL) {
+		uint32_t site = traceSite(filename, lineNumber);
+		fputc(oldMemory != NULL ? 'R' : 'A', g_traceFile);
+		if (oldMemory != NULL)
+			traceAddress(oldMemory);
+		traceAddress(memory);
+		traceNumber(size);
+		traceNumber(site);
+	}
+	trace_Unlock();
+}
+
+static void
+traceFree(void* memory) {
+	if (g_traceFile == NULL)
+		return;
+
+	trace_Lock();
+	if (g_traceFile != NULL) {
+		fputc('F', g_traceFile);
+		traceAddress(memory);
+	}
+	trace_Unlock();
+}
+
+bool
+mem_TraceStart(const char* filename) {
+	static bool registered = false;
+
+	mem_TraceStop();
+
+	FILE* fileHandle = fopen(filename, "wb");
+	if (fileHandle == NULL)
+		return false;
+
+	setvbuf(fileHandle, NULL, _IOFBF, 1024 * 1024);
+	fwrite(TRACE_MAGIC, 1, 8, fileHandle);
+
+	if (!registered) {
+		atexit(mem_TraceStop);
+		registered = true;
+	}
+
+	trace_Lock();
+	g_traceAddress = 0;
+	g_traceFile = fileHandle;
+	trace_Unlock();
+	return true;
+}
+
+void
+mem_TraceStop(void) {
+	trace_Lock();
+	FILE* fileHandle = g_traceFile;
+	g_traceFile = NULL;
+#if defined(_DEBUG)
+	free(g_traceSites);
+	g_traceSites = NULL;
+	g_traceSiteCapacity = 0;
+	g_traceSiteCount = 0;
+#endif
+	trace_Unlock();
+
+	if (fileHandle != NULL)
+		fclose(fileHandle);
+}
+#elif !defined(ASMOTOR_INLINE_MEMORY) && !defined(ASMOTOR_FAKE_ALLOC)
+#define traceAlloc(oldMemory, memory, size, filename, lineNumber)
+#define traceFree(memory)
+#endif
+
+#if !defined(ASMOTOR_INLINE_MEMORY) && !defined(ASMOTOR_FAKE_ALLOC) && !defined(ASMOTOR_NO_SLAB_ALLOC)
+#define SLAB_ALLOC
+#endif
+
+#if defined(SLAB_ALLOC)
+// Small blocks are served from per size class slabs. Freed blocks are kept on a free list for their class and
+// the slab pages are never returned to the C library.
+
+#define SLAB_GRANULARITY 16U
+#define SLAB_CLASSES     16U
+#define SLAB_MAX_SIZE    (SLAB_GRANULARITY * SLAB_CLASSES)
+#define SLAB_PAGE_SIZE   (64U * 1024U)
+
+typedef struct SlabBlock {
+	struct SlabBlock* next;
+} SSlabBlock;
+
+typedef struct {
+	SSlabBlock* freeList;
+	uint8_t* current;
+	uint8_t* end;
+} SSlabClass;
+
+static SSlabClass g_slabs[SLAB_CLASSES];
+
+INLINE size_t
+slabClass(size_t size) {
+	return (size - 1) / SLAB_GRANULARITY;
+}
+
+INLINE SSlabBlock*
+slabBlock(SMemoryChunk* chunk) {
+	return (SSlabBlock*) ((char*) chunk + HEADERSIZE);
+}
+
+INLINE SMemoryChunk*
+slabChunk(SSlabBlock* block) {
+	return (SMemoryChunk*) ((char*) block - HEADERSIZE);
+}
+
+static SSlabBlock*
+depotAlloc(size_t index) {
+	SSlabClass* slab = &g_slabs[index];
+
+	if (slab->freeList != NULL) {
+		SSlabBlock* block = slab->freeList;
+		slab->freeList = block->next;
+		return block;
+	}
+
+	size_t blockSize = BLOCK_OVERHEAD + (index + 1) * SLAB_GRANULARITY;
+	if (slab->current == NULL || (size_t) (slab->end - slab->current) < blockSize) {
+		uint8_t* page = malloc(SLAB_PAGE_SIZE);
+		if (page == NULL)
+			return NULL;
+
+		slab->current = page;
+		slab->end = page + SLAB_PAGE_SIZE;
+	}
+
+	SSlabBlock* block = slabBlock((SMemoryChunk*) slab->current);
+	slab->current += blockSize;
+	return block;
+}
+
+INLINE void
+depotFree(SSlabBlock* block, size_t index) {
+	SSlabClass* slab = &g_slabs[index];
+	block->next = slab->freeList;
+	slab->freeList = block;
+}
+
+#if defined(ASMOTOR_THREADSAFE_MEMORY)
+// Each thread keeps a small cache of free blocks per size class. The shared slabs (the depot) are only locked
+// when a cache runs dry or overflows, and then a whole batch of blocks moves at once.
+
+#define THREAD_CACHE_BATCH 32U
+#define THREAD_CACHE_LIMIT (THREAD_CACHE_BATCH * 4U)
+
+typedef struct {
+	SSlabBlock* freeList;
+	uint32_t count;
+} SThreadCache;
+
+static mem_lock_t g_slabLock;
+static THREAD_LOCAL SThreadCache t_slabCaches[SLAB_CLASSES];
+
+static void
+refillThreadCache(SThreadCache* cache, size_t index) {
+	lock_Acquire(&g_slabLock);
+	while (cache->count < THREAD_CACHE_BATCH) {
+		SSlabBlock* block = depotAlloc(index);
+		if (block == NULL)
+			break;
+
+		block->next = cache->freeList;
+		cache->freeList = block;
+		++cache->count;
+	}
+	lock_Release(&g_slabLock);
+}
+
+static void
+drainThreadCache(SThreadCache* cache, size_t index, uint32_t keep) {
+	lock_Acquire(&g_slabLock);
+	while (cache->count > keep) {
+		SSlabBlock* block = cache->freeList;
+		cache->freeList = block->next;
+		--cache->count;
+		depotFree(block, index);
+	}
+	lock_Release(&g_slabLock);
+}
+
+static SMemoryChunk*
+slabAlloc(size_t size) {
+	size_t index = slabClass(size);
+	SThreadCache* cache = &t_slabCaches[index];
+
+	if (cache->freeList == NULL) {
+		refillThreadCache(cache, index);
+		if (cache->freeList == NULL)
+			return NULL;
+	}
+
+	SSlabBlock* block = cache->freeList;
+	cache->freeList = block->next;
+	--cache->count;
+	return slabChunk(block);
+}
+
+static void
+slabFree(SMemoryChunk* chunk, size_t size) {
+	size_t index = slabClass(size);
+	SThreadCache* cache = &t_slabCaches[index];
+
+	SSlabBlock* block = slabBlock(chunk);
+	block->next = cache->freeList;
+	cache->freeList = block;
+
+	if (++cache->count > THREAD_CACHE_LIMIT)
+		drainThreadCache(cache, index, THREAD_CACHE_LIMIT - THREAD_CACHE_BATCH);
+}
+#else
+static SMemoryChunk*
+slabAlloc(size_t size) {
+	SSlabBlock* block = depotAlloc(slabClass(size));
+	return block != NULL ? slabChunk(block) : NULL;
+}
+
+static void
+slabFree(SMemoryChunk* chunk, size_t size) {
+	depotFree(slabBlock(chunk), slabClass(size));
+}
+#endif
+#endif
+
+#if defined(ASMOTOR_THREADSAFE_MEMORY)
+void
+mem_ReleaseThreadCache(void) {
+	str_ReleaseThreadPool();
+
+#if defined(SLAB_ALLOC)
+	for (size_t i = 0; i < SLAB_CLASSES; ++i) {
+		if (t_slabCaches[i].count > 0)
+			drainThreadCache(&t_slabCaches[i], i, 0);
+	}
+#endif
+}
+#endif
+
+#if !defined(ASMOTOR_INLINE_MEMORY) && !defined(ASMOTOR_FAKE_ALLOC) && (defined(__unix__) || defined(__APPLE__)) \
+    && !defined(ASMOTOR_NO_MMAP_ALLOC)
+#define MMAP_ALLOC
+#endif
+
+#if defined(MMAP_ALLOC)
+// Large blocks are backed directly by anonymous memory mappings. On Linux they grow with mremap, which moves page
+// table entries rather than copying the contents. Growth within the last mapped page needs no system call at all.
+
+#define MMAP_THRESHOLD (256U * 1024U)
+#define HUGE_PAGE_SIZE (2U * 1024U * 1024U)
+
+static size_t g_pageSize = 0;
+
+INLINE size_t
+mappedLength(size_t size) {
+	if (g_pageSize == 0)
+		g_pageSize = (size_t) sysconf(_SC_PAGESIZE);
+	return (size + BLOCK_OVERHEAD + g_pageSize - 1) & ~(g_pageSize - 1);
+}
+
+static SMemoryChunk*
+mapChunk(size_t size) {
+	size_t length = mappedLength(size);
+	void* mem = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (mem == MAP_FAILED)
+		return NULL;
+
+#if defined(ASMOTOR_HUGE_PAGES) && defined(MADV_HUGEPAGE)
+	if (length >= HUGE_PAGE_SIZE)
+		madvise(mem, length, MADV_HUGEPAGE);
+#endif
+	return (SMemoryChunk*) mem;
+}
+
+static SMemoryChunk*
+remapChunk(SMemoryChunk* chunk, size_t oldSize, size_t size) {
+	size_t oldLength = mappedLength(oldSize);
+	size_t length = mappedLength(size);
+	if (length == oldLength)
+		return chunk;
+
+#if defined(__linux__)
+	void* mem = mremap(chunk, oldLength, length, MREMAP_MAYMOVE);
+	if (mem == MAP_FAILED)
+		return NULL;
+
+#if defined(ASMOTOR_HUGE_PAGES) && defined(MADV_HUGEPAGE)
+	if (length >= HUGE_PAGE_SIZE)
+		madvise(mem, length, MADV_HUGEPAGE);
+#endif
+	return (SMemoryChunk*) mem;
+#else
+	if (length < oldLength) {
+		munmap((char*) chunk + length, oldLength - length);
+		return chunk;
+	}
+
+	SMemoryChunk* newChunk = mapChunk(size);
+	if (newChunk != NULL) {
+		memcpy(newChunk, chunk, oldSize + BLOCK_OFFSET);
+		munmap(chunk, oldLength);
+	}
+	return newChunk;
+#endif
+}
+
+INLINE void
+unmapChunk(SMemoryChunk* chunk, size_t size) {
+	munmap(chunk, mappedLength(size));
+}
+#endif
+
+#if !defined(ASMOTOR_INLINE_MEMORY) && !defined(ASMOTOR_FAKE_ALLOC)
+// Every block is served by one of three backends, chosen by the block size alone so the size stored in the
+// header is enough to find the backend again when the block is freed or resized.
+
+typedef enum {
+	BLOCK_SLAB,
+	BLOCK_HEAP,
+	BLOCK_MAPPED
+} EBlockKind;
+
+INLINE EBlockKind
+blockKind(size_t size) {
+#if defined(SLAB_ALLOC)
+	if (size <= SLAB_MAX_SIZE)
+		return BLOCK_SLAB;
+#endif
+#if defined(MMAP_ALLOC)
+	if (size >= MMAP_THRESHOLD)
+		return BLOCK_MAPPED;
+#endif
+	return BLOCK_HEAP;
+}
+
+static SMemoryChunk*
+allocChunk(size_t size) {
+	switch (blockKind(size)) {
+#if defined(SLAB_ALLOC)
+		case BLOCK_SLAB:
+			return slabAlloc(size);
+#endif
+#if defined(MMAP_ALLOC)
+		case BLOCK_MAPPED:
+			return mapChunk(size);
+#endif
+		default:
+			return malloc(size + BLOCK_OVERHEAD);
+	}
+}
+
+static void
+freeChunk(SMemoryChunk* chunk, size_t size) {
+	switch (blockKind(size)) {
+#if defined(SLAB_ALLOC)
+		case BLOCK_SLAB:
+			slabFree(chunk, size);
+			break;
+#endif
+#if defined(MMAP_ALLOC)
+		case BLOCK_MAPPED:
+			unmapChunk(chunk, size);
+			break;
+#endif
+		default:
+			free(chunk);
+			break;
+	}
+}
+
+static SMemoryChunk*
+reallocChunk(SMemoryChunk* chunk, size_t size) {
+	size_t oldSize = chunk->size;
+	EBlockKind kind = blockKind(size);
+
+	if (kind == blockKind(oldSize)) {
+		switch (kind) {
+#if defined(SLAB_ALLOC)
+			case BLOCK_SLAB:
+				if (slabClass(oldSize) == slabClass(size))
+					return chunk;
+				break;
+#endif
+#if defined(MMAP_ALLOC)
+			case BLOCK_MAPPED:
+				return remapChunk(chunk, oldSize, size);
+#endif
+			default:
+				return realloc(chunk, size + BLOCK_OVERHEAD);
+		}
+	}
+
+	SMemoryChunk* newChunk = allocChunk(size);
+	if (newChunk != NULL) {
+		memcpy((char*) newChunk + BLOCK_OFFSET, (char*) chunk + BLOCK_OFFSET, oldSize < size ? oldSize : size);
+		freeChunk(chunk, oldSize);
+	}
+	return newChunk;
+}
 #endif
-} SMemoryChunk;
 
-#if defined(ASMOTOR_FAKE_ALLOC)
-uint32_t g_memory[1024 * 1024 / 4];
-uint8_t* g_fakeMalloc = (uint8_t*) g_memory;
+#if defined(_DEBUG) && !defined(ASMOTOR_INLINE_MEMORY) && !defined(ASMOTOR_FAKE_ALLOC)
+// Fill a range of a block with the 0xDEADBEEF pattern, a machine word at a time. The pattern is anchored at the
+// start of the block, so a block grown by mem_Realloc continues it seamlessly.
+static void
+poisonFill(uint8_t* mem, size_t from, size_t to) {
+	static const uint8_t pattern[8] = {0xDE, 0xAD, 0xBE, 0xEF, 0xDE, 0xAD, 0xBE, 0xEF};
 
-extern void*
-mem_AllocImpl(size_t size, const char* filename, int lineNumber) {
-	void* r = g_fakeMalloc;
-	g_fakeMalloc += (size + 3) & -4;
-	return r;
+	while (from < to && (from & 7U) != 0) {
+		mem[from] = pattern[from & 7U];
+		++from;
+	}
+
+	uint64_t word;
+	memcpy(&word, pattern, sizeof(word));
+	for (; from + 8 <= to; from += 8) {
+		memcpy(&mem[from], &word, sizeof(word));
+	}
+
+	while (from < to) {
+		mem[from] = pattern[from & 7U];
+		++from;
+	}
 }
 
-#endif
+static void
+writeRedZones(SMemoryChunk* chunk) {
+	uint8_t* mem = (uint8_t*) chunk + BLOCK_OFFSET;
+	memset(mem - REDZONE_SIZE, REDZONE_PATTERN, REDZONE_SIZE);
+	memset(mem + chunk->size, REDZONE_PATTERN, REDZONE_SIZE);
+}
 
-#if !defined(ASMOTOR_INLINE_MEMORY) && !defined(ASMOTOR_FAKE_ALLOC)
-static SMemoryChunk* g_memoryList = NULL;
+static bool
+redZoneIntact(const uint8_t* zone) {
+	for (size_t i = 0; i < REDZONE_SIZE; ++i) {
+		if (zone[i] != REDZONE_PATTERN)
+			return false;
+	}
+	return true;
+}
+
+static void
+checkRedZones(SMemoryChunk* chunk, const char* operation) {
+	const uint8_t* mem = (const uint8_t*) chunk + BLOCK_OFFSET;
+	bool frontIntact = redZoneIntact(mem - REDZONE_SIZE);
+	bool backIntact = redZoneIntact(mem + chunk->size);
+
+	if (!frontIntact || !backIntact) {
+		fprintf(stderr, "Memory corruption detected in %s: %s of %zu byte block allocated at %s:%d (%p) was overwritten\n",
+		        operation, !frontIntact ? "start" : "end", chunk->size, chunk->filename, chunk->lineNumber, (void*) mem);
+		exit(EXIT_FAILURE);
+	}
+}
 #endif
 
 #if !defined(ASMOTOR_INLINE_MEMORY) && !defined(ASMOTOR_FAKE_ALLOC)
+// Heap budget and low memory handler. The budget is checked against the live byte count kept for mem_GetStats,
+// so without a budget the check is a single comparison. The handler is only consulted when an allocation fails.
+
+static size_t g_budget = 0;
+static mem_low_memory_t g_lowMemoryHandler = NULL;
+
+void
+mem_SetBudget(size_t bytes) {
+	g_budget = bytes;
+}
+
+void
+mem_SetLowMemoryHandler(mem_low_memory_t handler) {
+	g_lowMemoryHandler = handler;
+}
+
+INLINE bool
+withinBudget(size_t size, size_t oldSize) {
+	return g_budget == 0 || ATOMIC_LOAD(&g_liveBytes) - oldSize + size <= g_budget;
+}
+
+// Give the low memory handler a chance to release memory, returns true if the allocation should be retried
+static bool
+releaseMemory(size_t size) {
+	return g_lowMemoryHandler != NULL && g_lowMemoryHandler(size);
+}
+
+INLINE SMemoryChunk*
+tryAllocChunk(size_t size) {
+	do {
+		SMemoryChunk* chunk = withinBudget(size, 0) ? allocChunk(size) : NULL;
+		if (chunk != NULL)
+			return chunk;
+	} while (releaseMemory(size));
+	return NULL;
+}
+
+// The chunk must not be registered while it may move. If it cannot be resized it is left untouched.
+static SMemoryChunk*
+tryReallocChunk(SMemoryChunk* chunk, size_t size) {
+	do {
+		SMemoryChunk* newChunk = withinBudget(size, chunk->size) ? reallocChunk(chunk, size) : NULL;
+		if (newChunk != NULL)
+			return newChunk;
+	} while (releaseMemory(size));
+	return NULL;
+}
+
 static void*
 #if defined(_DEBUG)
 CheckMemPointer(SMemoryChunk* chunk, size_t size, const char* filename, int lineNumber) {
@@ -75,72 +1175,132 @@ checkMemPointer(SMemoryChunk* chunk, size_t size) {
 #if defined(_DEBUG)
 	chunk->filename = filename;
 	chunk->lineNumber = lineNumber;
+	writeRedZones(chunk);
 #endif
-	list_Insert(g_memoryList, chunk);
-
-	return (char*) chunk + HEADERSIZE;
-}
+#if defined(PROFILE_ALLOC)
+	profileAlloc(chunk);
 #endif
+	registerChunk(chunk);
+	stats_Alloc(size);
 
-#if defined(_DEBUG) && !defined(ASMOTOR_INLINE_MEMORY) && !defined(ASMOTOR_FAKE_ALLOC)
-void*
-mem_AllocImpl(size_t size, const char* filename, int lineNumber) {
-	assert(size != 0);
-	uint8_t* mem = CheckMemPointer(malloc(size + HEADERSIZE), size, filename, lineNumber);
-	for (size_t i = 0; i < size; ++i) {
-		switch (i & 3) {
-			case 0:
-				mem[i] = 0xDE;
-				break;
-			case 1:
-				mem[i] = 0xAD;
-				break;
-			case 2:
-				mem[i] = 0xBE;
-				break;
-			case 3:
-				mem[i] = 0xEF;
-				break;
-		}
-	}
-	return mem;
+	return (char*) chunk + BLOCK_OFFSET;
 }
-#elif !defined(ASMOTOR_INLINE_MEMORY) && !defined(ASMOTOR_FAKE_ALLOC)
 
-void*
-mem_Alloc(size_t size) {
+// Allocation and reallocation proper. When fatal is false a failed allocation returns NULL, otherwise the
+// program exits.
+
+static void*
+#if defined(_DEBUG)
+allocMemory(size_t size, bool fatal, const char* filename, int lineNumber) {
+#else
+allocMemory(size_t size, bool fatal) {
+#endif
 	assert(size != 0);
-	return checkMemPointer(malloc(size + HEADERSIZE), size);
-}
+	SMemoryChunk* chunk = tryAllocChunk(size);
+	if (chunk == NULL && !fatal)
+		return NULL;
 
+#if defined(_DEBUG)
+	uint8_t* mem = CheckMemPointer(chunk, size, filename, lineNumber);
+	poisonFill(mem, 0, size);
+	traceAlloc(NULL, mem, size, filename, lineNumber);
+#else
+	void* mem = checkMemPointer(chunk, size);
+	traceAlloc(NULL, mem, size, NULL, 0);
 #endif
+	return mem;
+}
 
-#if !defined(ASMOTOR_INLINE_MEMORY) && !defined(ASMOTOR_FAKE_ALLOC)
-void*
+static void*
 #if defined(_DEBUG)
-mem_ReallocImpl(void* memory, size_t size, const char* filename, int lineNumber) {
+reallocMemory(void* memory, size_t size, bool fatal, const char* filename, int lineNumber) {
 #else
-mem_Realloc(void* memory, size_t size) {
+reallocMemory(void* memory, size_t size, bool fatal) {
 #endif
 	if (memory == NULL) {
 #if defined(_DEBUG)
-		return mem_AllocImpl(size, filename, lineNumber);
+		return allocMemory(size, fatal, filename, lineNumber);
 #else
-		return mem_Alloc(size);
+		return allocMemory(size, fatal);
 #endif
 	} else if (size == 0) {
 		mem_Free(memory);
 		return NULL;
-	} else {
-		SMemoryChunk* chunk = (SMemoryChunk*) ((char*) memory - HEADERSIZE);
-		list_Remove(g_memoryList, chunk);
+	}
 
+	SMemoryChunk* chunk = (SMemoryChunk*) ((char*) memory - BLOCK_OFFSET);
+	size_t oldSize = chunk->size;
 #if defined(_DEBUG)
-		return CheckMemPointer(realloc(chunk, size + HEADERSIZE), size, filename, lineNumber);
-#else
-		return checkMemPointer(realloc(chunk, size + HEADERSIZE), size);
+	checkRedZones(chunk, "mem_Realloc");
+#endif
+	unregisterChunk(chunk);
+
+	// The old header is needed to close the profile of the block, and reallocChunk only moves the contents
+#if defined(PROFILE_ALLOC)
+	SMemoryChunk header = *chunk;
 #endif
+	SMemoryChunk* newChunk = tryReallocChunk(chunk, size);
+	if (newChunk == NULL && !fatal) {
+		registerChunk(chunk);
+		return NULL;
 	}
+
+#if defined(PROFILE_ALLOC)
+	profileFree(&header);
+#endif
+	stats_Free(oldSize);
+
+#if defined(_DEBUG)
+	uint8_t* mem = CheckMemPointer(newChunk, size, filename, lineNumber);
+	poisonFill(mem, oldSize, size);
+	traceAlloc(memory, mem, size, filename, lineNumber);
+#else
+	void* mem = checkMemPointer(newChunk, size);
+	traceAlloc(memory, mem, size, NULL, 0);
+#endif
+	return mem;
+}
+#endif
+
+#if defined(_DEBUG) && !defined(ASMOTOR_INLINE_MEMORY) && !defined(ASMOTOR_FAKE_ALLOC)
+void*
+mem_AllocImpl(size_t size, const char* filename, int lineNumber) {
+	return allocMemory(size, true, filename, lineNumber);
+}
+
+void*
+mem_ReallocImpl(void* memory, size_t size, const char* filename, int lineNumber) {
+	return reallocMemory(memory, size, true, filename, lineNumber);
+}
+
+void*
+mem_TryAllocImpl(size_t size, const char* filename, int lineNumber) {
+	return allocMemory(size, false, filename, lineNumber);
+}
+
+void*
+mem_TryReallocImpl(void* memory, size_t size, const char* filename, int lineNumber) {
+	return reallocMemory(memory, size, false, filename, lineNumber);
+}
+#elif !defined(ASMOTOR_INLINE_MEMORY) && !defined(ASMOTOR_FAKE_ALLOC)
+void*
+mem_Alloc(size_t size) {
+	return allocMemory(size, true);
+}
+
+void*
+mem_Realloc(void* memory, size_t size) {
+	return reallocMemory(memory, size, true);
+}
+
+void*
+mem_TryAlloc(size_t size) {
+	return allocMemory(size, false);
+}
+
+void*
+mem_TryRealloc(void* memory, size_t size) {
+	return reallocMemory(memory, size, false);
 }
 #endif
 
@@ -148,17 +1308,216 @@ mem_Realloc(void* memory, size_t size) {
 void
 mem_Free(void* memory) {
 	if (memory != NULL) {
-		SMemoryChunk* chunk = (SMemoryChunk*) ((char*) memory - HEADERSIZE);
+		SMemoryChunk* chunk = (SMemoryChunk*) ((char*) memory - BLOCK_OFFSET);
 
-		assert(chunk->size != 0);
+		size_t size = chunk->size;
+		assert(size != 0);
+#if defined(_DEBUG)
+		checkRedZones(chunk, "mem_Free");
+#endif
 
-		list_Remove(g_memoryList, chunk);
+		unregisterChunk(chunk);
+#if defined(PROFILE_ALLOC)
+		profileFree(chunk);
+#endif
+		stats_Free(size);
+		traceFree(memory);
 		chunk->size = 0;
 
-		free(chunk);
+		freeChunk(chunk, size);
+	}
+}
+#endif
+
+// Region allocator
+
+#define ARENA_HEADERSIZE ((sizeof(SArenaChunk) + (ALIGN - 1)) & -ALIGN)
+#define ARENA_ROUND(size) (((size) + (ALIGN - 1)) & -ALIGN)
+
+typedef struct ArenaChunk {
+	struct ArenaChunk* next;
+	size_t size;
+	size_t used;
+} SArenaChunk;
+
+struct MemoryArena {
+	SArenaChunk* chunks;
+	size_t chunkSize;
+	void* lastBlock;
+};
+
+static void
+freeArenaChunks(SArenaChunk* chunk, SArenaChunk* until) {
+	while (chunk != until) {
+		SArenaChunk* next = chunk->next;
+		mem_Free(chunk);
+		chunk = next;
+	}
+}
+
+mem_arena_t*
+mem_ArenaCreate(size_t chunkSize) {
+	mem_arena_t* arena = mem_Alloc(sizeof(mem_arena_t));
+	arena->chunks = NULL;
+	arena->chunkSize = chunkSize == 0 ? MEM_ARENA_DEFAULT_CHUNK_SIZE : ARENA_ROUND(chunkSize);
+	arena->lastBlock = NULL;
+
+	return arena;
+}
+
+void
+mem_ArenaFree(mem_arena_t* arena) {
+	if (arena != NULL) {
+		freeArenaChunks(arena->chunks, NULL);
+		mem_Free(arena);
+	}
+}
+
+void*
+mem_ArenaAlloc(mem_arena_t* arena, size_t size) {
+	assert(arena != NULL);
+
+	size = ARENA_ROUND(size == 0 ? 1 : size);
+
+	SArenaChunk* chunk = arena->chunks;
+	if (chunk == NULL || chunk->size - chunk->used < size) {
+		size_t chunkSize = size > arena->chunkSize ? size : arena->chunkSize;
+		chunk = mem_Alloc(ARENA_HEADERSIZE + chunkSize);
+		chunk->next = arena->chunks;
+		chunk->size = chunkSize;
+		chunk->used = 0;
+		arena->chunks = chunk;
+	}
+
+	void* block = (char*) chunk + ARENA_HEADERSIZE + chunk->used;
+	chunk->used += size;
+	arena->lastBlock = block;
+
+	return block;
+}
+
+void*
+mem_ArenaRealloc(mem_arena_t* arena, void* memory, size_t oldSize, size_t newSize) {
+	assert(arena != NULL);
+
+	if (memory == NULL)
+		return mem_ArenaAlloc(arena, newSize);
+
+	if (memory == arena->lastBlock) {
+		SArenaChunk* chunk = arena->chunks;
+		size_t offset = (size_t) ((char*) memory - ((char*) chunk + ARENA_HEADERSIZE));
+		size_t size = ARENA_ROUND(newSize == 0 ? 1 : newSize);
+		if (chunk->size - offset >= size) {
+			chunk->used = offset + size;
+			return memory;
+		}
+	}
+
+	void* block = mem_ArenaAlloc(arena, newSize);
+	memcpy(block, memory, oldSize < newSize ? oldSize : newSize);
+	return block;
+}
+
+mem_arena_mark_t
+mem_ArenaMark(mem_arena_t* arena) {
+	assert(arena != NULL);
+
+	mem_arena_mark_t mark;
+	mark.chunk = arena->chunks;
+	mark.used = arena->chunks != NULL ? arena->chunks->used : 0;
+	return mark;
+}
+
+void
+mem_ArenaRollback(mem_arena_t* arena, mem_arena_mark_t mark) {
+	assert(arena != NULL);
+
+	freeArenaChunks(arena->chunks, (SArenaChunk*) mark.chunk);
+	arena->chunks = (SArenaChunk*) mark.chunk;
+	if (arena->chunks != NULL)
+		arena->chunks->used = mark.used;
+	arena->lastBlock = NULL;
+}
+
+size_t
+mem_ArenaUsage(mem_arena_t* arena) {
+	assert(arena != NULL);
+
+	size_t total = 0;
+	for (SArenaChunk* chunk = arena->chunks; chunk != NULL; chunk = chunk->next) {
+		total += chunk->used;
 	}
+	return total;
+}
+
+// Aligned blocks are carved from a larger ordinary block. The distance from the start of the ordinary block is
+// stored in the word just before the aligned pointer.
+
+#define ALIGNED_OVERHEAD(alignment) (sizeof(size_t) + (alignment) - 1)
+
+INLINE size_t
+alignedOffset(uint8_t* mem, size_t alignment) {
+	uintptr_t aligned = ((uintptr_t) mem + sizeof(size_t) + alignment - 1) & ~(uintptr_t) (alignment - 1);
+	return (size_t) (aligned - (uintptr_t) mem);
+}
+
+INLINE uint8_t*
+alignBlock(uint8_t* mem, size_t offset) {
+	((size_t*) (mem + offset))[-1] = offset;
+	return mem + offset;
+}
+
+INLINE uint8_t*
+alignedBase(void* memory) {
+	return (uint8_t*) memory - ((size_t*) memory)[-1];
+}
+
+void*
+#if defined(_DEBUG)
+mem_AllocAlignedImpl(size_t size, size_t alignment, const char* filename, int lineNumber) {
+	assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+	uint8_t* mem = mem_AllocImpl(size + ALIGNED_OVERHEAD(alignment), filename, lineNumber);
+#else
+mem_AllocAligned(size_t size, size_t alignment) {
+	assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+	uint8_t* mem = mem_Alloc(size + ALIGNED_OVERHEAD(alignment));
+#endif
+	return mem != NULL ? alignBlock(mem, alignedOffset(mem, alignment)) : NULL;
 }
+
+void*
+#if defined(_DEBUG)
+mem_ReallocAlignedImpl(void* memory, size_t size, size_t alignment, const char* filename, int lineNumber) {
+	if (memory == NULL)
+		return mem_AllocAlignedImpl(size, alignment, filename, lineNumber);
+#else
+mem_ReallocAligned(void* memory, size_t size, size_t alignment) {
+	if (memory == NULL)
+		return mem_AllocAligned(size, alignment);
+#endif
+
+	size_t oldOffset = ((size_t*) memory)[-1];
+#if defined(_DEBUG)
+	uint8_t* mem = mem_ReallocImpl(alignedBase(memory), size + ALIGNED_OVERHEAD(alignment), filename, lineNumber);
+#else
+	uint8_t* mem = mem_Realloc(alignedBase(memory), size + ALIGNED_OVERHEAD(alignment));
 #endif
+	if (mem == NULL)
+		return NULL;
+
+	// The underlying block may have moved to an address with a different alignment, in which case the contents
+	// must be shifted. Any offset leaves room for size bytes, so the move stays within the block.
+	size_t offset = alignedOffset(mem, alignment);
+	if (offset != oldOffset)
+		memmove(mem + offset, mem + oldOffset, size);
+	return alignBlock(mem, offset);
+}
+
+void
+mem_FreeAligned(void* memory) {
+	if (memory != NULL)
+		mem_Free(alignedBase(memory));
+}
 
 void
 hexDumpLine(const uint8_t* data, size_t count) {
@@ -191,15 +1550,231 @@ mem_HexDump(const uint8_t* data, size_t count) {
 	}
 }
 
-#if !defined(ASMOTOR_INLINE_MEMORY) && !defined(ASMOTOR_FAKE_ALLOC)
+#if defined(_DEBUG) && !defined(ASMOTOR_INLINE_MEMORY) && !defined(ASMOTOR_FAKE_ALLOC)
+// Live blocks grouped by allocation site, used by the leak report and heap snapshots
+
+#define LEAK_SAMPLE_SIZE 32U
+
+typedef struct {
+	const char* filename;
+	int lineNumber;
+	size_t blocks;
+	size_t bytes;
+	size_t sampleSize;
+	uint8_t sample[LEAK_SAMPLE_SIZE];
+} SLiveSite;
+
+struct MemorySnapshot {
+	SLiveSite* sites;
+	size_t count;
+};
+
+static bool
+growLiveSites(SLiveSite** table, size_t* capacity) {
+	size_t newCapacity = *capacity == 0 ? 256 : *capacity * 2;
+	SLiveSite* sites = calloc(newCapacity, sizeof(SLiveSite));
+	if (sites == NULL)
+		return false;
+
+	for (size_t i = 0; i < *capacity; ++i) {
+		SLiveSite* site = &(*table)[i];
+		if (site->filename != NULL) {
+			size_t index = siteHash(site->filename, site->lineNumber) & (newCapacity - 1);
+			while (sites[index].filename != NULL)
+				index = (index + 1) & (newCapacity - 1);
+			sites[index] = *site;
+		}
+	}
+
+	free(*table);
+	*table = sites;
+	*capacity = newCapacity;
+	return true;
+}
+
+static int
+compareLiveSiteKeys(const void* lhs, const void* rhs) {
+	const SLiveSite* site1 = lhs;
+	const SLiveSite* site2 = rhs;
+	if (site1->filename != site2->filename)
+		return (uintptr_t) site1->filename < (uintptr_t) site2->filename ? -1 : 1;
+	return site1->lineNumber - site2->lineNumber;
+}
+
+static int
+compareLiveSiteBytes(const void* lhs, const void* rhs) {
+	const SLiveSite* site1 = lhs;
+	const SLiveSite* site2 = rhs;
+	if (site1->bytes != site2->bytes)
+		return site1->bytes < site2->bytes ? 1 : -1;
+	return compareLiveSiteKeys(lhs, rhs);
+}
+
+// Group the live blocks by site. The result is compacted and sorted by site, and a sample of the first block seen
+// from each site is copied so it can be printed after the registry locks have been released.
+static SLiveSite*
+collectLiveSites(size_t* count) {
+	SLiveSite* table = NULL;
+	size_t capacity = 0;
+	size_t used = 0;
+
+	for (size_t i = 0; i < REGISTRY_SHARDS; ++i) {
+		SRegistryShard* shard = &g_memoryShards[i];
+		registry_Lock(shard);
+		for (SMemoryChunk* chunk = shard->list; chunk != NULL; chunk = list_GetNext(chunk)) {
+			if (used * 2 >= capacity && !growLiveSites(&table, &capacity))
+				break;
+
+			size_t index = siteHash(chunk->filename, chunk->lineNumber) & (capacity - 1);
+			SLiveSite* site = &table[index];
+			while (site->filename != NULL && (site->filename != chunk->filename || site->lineNumber != chunk->lineNumber)) {
+				index = (index + 1) & (capacity - 1);
+				site = &table[index];
+			}
+
+			if (site->filename == NULL) {
+				site->filename = chunk->filename;
+				site->lineNumber = chunk->lineNumber;
+				site->sampleSize = chunk->size < LEAK_SAMPLE_SIZE ? chunk->size : LEAK_SAMPLE_SIZE;
+				memcpy(site->sample, (uint8_t*) chunk + BLOCK_OFFSET, site->sampleSize);
+				++used;
+			}
+			site->blocks += 1;
+			site->bytes += chunk->size;
+		}
+		registry_Unlock(shard);
+	}
+
+	size_t total = 0;
+	for (size_t i = 0; i < capacity; ++i) {
+		if (table[i].filename != NULL)
+			table[total++] = table[i];
+	}
+
+	if (total > 1)
+		qsort(table, total, sizeof(SLiveSite), compareLiveSiteKeys);
+	*count = total;
+	return table;
+}
+
 void
 mem_ShowLeaks(void) {
-#if defined(_DEBUG)
-	for (SMemoryChunk* chunk = g_memoryList; chunk != NULL; chunk = list_GetNext(chunk)) {
-		uint8_t* data = ((uint8_t*) chunk) + sizeof(SMemoryChunk);
-		printf("Leak %s:%d (%p)\n", chunk->filename, chunk->lineNumber, (void*) data);
-		mem_HexDump(data, 32);
+	size_t count;
+	SLiveSite* sites = collectLiveSites(&count);
+	if (count == 0) {
+		free(sites);
+		return;
 	}
-#endif
+
+	qsort(sites, count, sizeof(SLiveSite), compareLiveSiteBytes);
+
+	size_t totalBlocks = 0;
+	size_t totalBytes = 0;
+	for (size_t i = 0; i < count; ++i) {
+		SLiveSite* site = &sites[i];
+		printf("Leaked %zu bytes in %zu blocks allocated at %s:%d\n", site->bytes, site->blocks, site->filename,
+		       site->lineNumber);
+		mem_HexDump(site->sample, site->sampleSize);
+		totalBlocks += site->blocks;
+		totalBytes += site->bytes;
+	}
+	printf("Leaked %zu bytes in %zu blocks from %zu sites\n", totalBytes, totalBlocks, count);
+
+	free(sites);
+}
+
+mem_snapshot_t*
+mem_Snapshot(void) {
+	mem_snapshot_t* snapshot = malloc(sizeof(mem_snapshot_t));
+	if (snapshot != NULL)
+		snapshot->sites = collectLiveSites(&snapshot->count);
+	return snapshot;
+}
+
+void
+mem_FreeSnapshot(mem_snapshot_t* snapshot) {
+	if (snapshot != NULL) {
+		free(snapshot->sites);
+		free(snapshot);
+	}
+}
+
+typedef struct {
+	const char* filename;
+	int lineNumber;
+	intptr_t blocks;
+	intptr_t bytes;
+	size_t liveBytes;
+} SSiteDelta;
+
+static int
+compareSiteDeltas(const void* lhs, const void* rhs) {
+	const SSiteDelta* delta1 = lhs;
+	const SSiteDelta* delta2 = rhs;
+	if (delta1->bytes != delta2->bytes)
+		return delta1->bytes < delta2->bytes ? 1 : -1;
+	return delta1->lineNumber - delta2->lineNumber;
 }
+
+void
+mem_DiffSnapshot(FILE* fileHandle, const mem_snapshot_t* snapshot) {
+	if (snapshot == NULL)
+		return;
+
+	size_t count;
+	SLiveSite* current = collectLiveSites(&count);
+	SSiteDelta* deltas = malloc((count + snapshot->count + 1) * sizeof(SSiteDelta));
+	if (deltas == NULL) {
+		free(current);
+		return;
+	}
+
+	// Both site lists are sorted by site, so they can be merged in one pass
+	size_t deltaCount = 0;
+	size_t i = 0;
+	size_t j = 0;
+	while (i < snapshot->count || j < count) {
+		const SLiveSite* before = i < snapshot->count ? &snapshot->sites[i] : NULL;
+		const SLiveSite* after = j < count ? &current[j] : NULL;
+		if (before != NULL && after != NULL) {
+			int order = compareLiveSiteKeys(before, after);
+			if (order < 0)
+				after = NULL;
+			else if (order > 0)
+				before = NULL;
+		}
+
+		SSiteDelta* delta = &deltas[deltaCount];
+		const SLiveSite* site = after != NULL ? after : before;
+		delta->filename = site->filename;
+		delta->lineNumber = site->lineNumber;
+		delta->blocks = (after != NULL ? (intptr_t) after->blocks : 0) - (before != NULL ? (intptr_t) before->blocks : 0);
+		delta->bytes = (after != NULL ? (intptr_t) after->bytes : 0) - (before != NULL ? (intptr_t) before->bytes : 0);
+		delta->liveBytes = after != NULL ? after->bytes : 0;
+		if (delta->blocks != 0 || delta->bytes != 0)
+			++deltaCount;
+
+		i += before != NULL;
+		j += after != NULL;
+	}
+
+	if (deltaCount > 1)
+		qsort(deltas, deltaCount, sizeof(SSiteDelta), compareSiteDeltas);
+
+	intptr_t totalBytes = 0;
+	fprintf(fileHandle, "%14s %12s %14s  %s\n", "bytes", "blocks", "live bytes", "site");
+	for (size_t k = 0; k < deltaCount; ++k) {
+		SSiteDelta* delta = &deltas[k];
+		fprintf(fileHandle, "%+14lld %+12lld %14zu  %s:%d\n", (long long) delta->bytes, (long long) delta->blocks,
+		        delta->liveBytes, delta->filename, delta->lineNumber);
+		totalBytes += delta->bytes;
+	}
+	fprintf(fileHandle, "%+14lld bytes in total\n", (long long) totalBytes);
+
+	free(deltas);
+	free(current);
+}
+#elif !defined(ASMOTOR_INLINE_MEMORY) && !defined(ASMOTOR_FAKE_ALLOC)
+void
+mem_ShowLeaks(void) {}
 #endif
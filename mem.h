@@ -24,16 +24,14 @@
 #include "util.h"
 
 #if defined(ASMOTOR_FAKE_ALLOC)
+/* Never-free bump allocator for short-lived runs. mem_Free does nothing, and the statistics count every byte
+ * handed out: growing a block in place adds the growth without counting an allocation, a block that moves to grow
+ * counts as a new allocation of its full size, and shrinking a block changes nothing. */
 extern void*
 mem_AllocImpl(size_t size, const char* filename, int lineNumber);
 
-INLINE void*
-mem_ReallocImpl(void* memory, size_t size, const char* filename, int lineNumber) {
-	void* d = mem_AllocImpl(size, filename, lineNumber);
-	if (memory != NULL)
-		memcpy(d, memory, size);
-	return d;
-}
+extern void*
+mem_ReallocImpl(void* memory, size_t size, const char* filename, int lineNumber);
 
 INLINE void*
 mem_Alloc(size_t size) {
@@ -45,6 +43,16 @@ mem_Realloc(void* memory, size_t size) {
 	return mem_ReallocImpl(memory, size, NULL, 0);
 }
 
+INLINE void*
+mem_TryAlloc(size_t size) {
+	return mem_AllocImpl(size, NULL, 0);
+}
+
+INLINE void*
+mem_TryRealloc(void* memory, size_t size) {
+	return mem_ReallocImpl(memory, size, NULL, 0);
+}
+
 INLINE void
 mem_Free(void* memory) {}
 
@@ -71,6 +79,16 @@ mem_Realloc(void* memory, size_t size) {
 	return realloc(memory, size);
 }
 
+INLINE void*
+mem_TryAlloc(size_t size) {
+	return malloc(size);
+}
+
+INLINE void*
+mem_TryRealloc(void* memory, size_t size) {
+	return realloc(memory, size);
+}
+
 INLINE void
 mem_Free(void* memory) {
 	free(memory);
@@ -85,18 +103,215 @@ mem_AllocImpl(size_t size, const char* filename, int lineNumber);
 extern void*
 mem_ReallocImpl(void* memory, size_t size, const char* filename, int lineNumber);
 
-#define mem_Alloc(size)           mem_AllocImpl(size, __FILE__, __LINE__)
-#define mem_Realloc(memory, size) mem_ReallocImpl(memory, size, __FILE__, __LINE__)
+extern void*
+mem_TryAllocImpl(size_t size, const char* filename, int lineNumber);
+
+extern void*
+mem_TryReallocImpl(void* memory, size_t size, const char* filename, int lineNumber);
+
+#define mem_Alloc(size)              mem_AllocImpl(size, __FILE__, __LINE__)
+#define mem_Realloc(memory, size)    mem_ReallocImpl(memory, size, __FILE__, __LINE__)
+#define mem_TryAlloc(size)           mem_TryAllocImpl(size, __FILE__, __LINE__)
+#define mem_TryRealloc(memory, size) mem_TryReallocImpl(memory, size, __FILE__, __LINE__)
 #else
 extern void*
 mem_Alloc(size_t size);
 
 extern void*
 mem_Realloc(void* memory, size_t size);
+
+extern void*
+mem_TryAlloc(size_t size);
+
+extern void*
+mem_TryRealloc(void* memory, size_t size);
 #endif
 
 extern void
 mem_Free(void* memory);
 
+/* Report the blocks still live, grouped by allocation site and largest first, with a sample of each site's data.
+ * Only debug builds keep track of live blocks. */
 extern void
 mem_ShowLeaks(void);
+
+/* Blocks aligned to a power of two, for buffers scanned with vector loads and data that must sit on its own cache
+ * line. Aligned blocks must be resized with mem_ReallocAligned, which keeps the alignment, and released with
+ * mem_FreeAligned. */
+#if defined(_DEBUG)
+extern void*
+mem_AllocAlignedImpl(size_t size, size_t alignment, const char* filename, int lineNumber);
+
+extern void*
+mem_ReallocAlignedImpl(void* memory, size_t size, size_t alignment, const char* filename, int lineNumber);
+
+#define mem_AllocAligned(size, alignment)           mem_AllocAlignedImpl(size, alignment, __FILE__, __LINE__)
+#define mem_ReallocAligned(memory, size, alignment) mem_ReallocAlignedImpl(memory, size, alignment, __FILE__, __LINE__)
+#else
+extern void*
+mem_AllocAligned(size_t size, size_t alignment);
+
+extern void*
+mem_ReallocAligned(void* memory, size_t size, size_t alignment);
+#endif
+
+extern void
+mem_FreeAligned(void* memory);
+
+/* Allocation statistics. totalAllocations counts every block handed out, including those returned by
+ * mem_Realloc. */
+typedef struct {
+	size_t liveBytes;
+	size_t peakBytes;
+	size_t liveAllocations;
+	uint64_t totalAllocations;
+} mem_stats_t;
+
+#if defined(ASMOTOR_INLINE_MEMORY)
+INLINE void
+mem_GetStats(mem_stats_t* stats) {
+	memset(stats, 0, sizeof(mem_stats_t));
+}
+#else
+extern void
+mem_GetStats(mem_stats_t* stats);
+#endif
+
+/* Heap budget. When a budget is set, allocations that would take the live bytes above it fail, as do allocations
+ * the C library cannot satisfy. A failed allocation first calls the low memory handler, which may release cached
+ * data and return true to have the allocation retried. If it returns false, mem_TryAlloc and mem_TryRealloc return
+ * NULL and leave the original block intact, while mem_Alloc and mem_Realloc exit the program. Set the budget and
+ * handler before allocating from several threads. A budget of 0, the default, is unlimited. */
+typedef bool (*mem_low_memory_t)(size_t size);
+
+#if !defined(ASMOTOR_INLINE_MEMORY) && !defined(ASMOTOR_FAKE_ALLOC)
+extern void
+mem_SetBudget(size_t bytes);
+
+extern void
+mem_SetLowMemoryHandler(mem_low_memory_t handler);
+#else
+INLINE void
+mem_SetBudget(size_t bytes) {}
+
+INLINE void
+mem_SetLowMemoryHandler(mem_low_memory_t handler) {}
+#endif
+
+/* Heap snapshots, available in debug builds. A snapshot records the live bytes and blocks per allocation site, and
+ * mem_DiffSnapshot writes how each site has grown or shrunk since, largest growth first. */
+struct MemorySnapshot;
+typedef struct MemorySnapshot mem_snapshot_t;
+
+#if defined(_DEBUG) && !defined(ASMOTOR_INLINE_MEMORY) && !defined(ASMOTOR_FAKE_ALLOC)
+extern mem_snapshot_t*
+mem_Snapshot(void);
+
+extern void
+mem_DiffSnapshot(FILE* fileHandle, const mem_snapshot_t* snapshot);
+
+extern void
+mem_FreeSnapshot(mem_snapshot_t* snapshot);
+#else
+INLINE mem_snapshot_t*
+mem_Snapshot(void) {
+	return NULL;
+}
+
+INLINE void
+mem_DiffSnapshot(FILE* fileHandle, const mem_snapshot_t* snapshot) {}
+
+INLINE void
+mem_FreeSnapshot(mem_snapshot_t* snapshot) {}
+#endif
+
+/* With ASMOTOR_PROFILE_MEMORY defined in a debug build, every allocation is attributed to the call site that made
+ * it. The profile holds allocation count, bytes, live and peak live bytes and a lifetime histogram per site, and
+ * can be written on demand or when the program exits. */
+typedef enum {
+	MEM_PROFILE_TEXT,
+	MEM_PROFILE_JSON
+} mem_profile_format_t;
+
+#if defined(ASMOTOR_PROFILE_MEMORY) && defined(_DEBUG) && !defined(ASMOTOR_INLINE_MEMORY) && !defined(ASMOTOR_FAKE_ALLOC)
+extern void
+mem_WriteProfile(FILE* fileHandle, mem_profile_format_t format);
+
+extern void
+mem_WriteProfileAtExit(const char* filename, mem_profile_format_t format);
+#else
+INLINE void
+mem_WriteProfile(FILE* fileHandle, mem_profile_format_t format) {}
+
+INLINE void
+mem_WriteProfileAtExit(const char* filename, mem_profile_format_t format) {}
+#endif
+
+/* With ASMOTOR_TRACE_MEMORY defined, every mem_Alloc, mem_Realloc and mem_Free between mem_TraceStart and
+ * mem_TraceStop is recorded to a compact binary trace, which tools/memreplay can replay against different
+ * allocators. Debug builds record the call site of each allocation as well. */
+#if defined(ASMOTOR_TRACE_MEMORY) && !defined(ASMOTOR_INLINE_MEMORY) && !defined(ASMOTOR_FAKE_ALLOC)
+extern bool
+mem_TraceStart(const char* filename);
+
+extern void
+mem_TraceStop(void);
+#else
+INLINE bool
+mem_TraceStart(const char* filename) {
+	return false;
+}
+
+INLINE void
+mem_TraceStop(void) {}
+#endif
+
+/* With ASMOTOR_THREADSAFE_MEMORY defined the allocator may be used from several threads at once. Each thread
+ * caches free small blocks and string pool cells, and should hand them back with mem_ReleaseThreadCache before it
+ * exits, or they are lost. Arenas and the containers are not synchronized and must only be used by one thread at a
+ * time. */
+#if defined(ASMOTOR_THREADSAFE_MEMORY)
+extern void
+mem_ReleaseThreadCache(void);
+#else
+INLINE void
+mem_ReleaseThreadCache(void) {}
+#endif
+
+/* Region allocator. Blocks are carved from large chunks and are never freed individually, instead the whole
+ * arena is released at once with mem_ArenaFree, or rolled back to a previously recorded mark. */
+
+struct MemoryArena;
+typedef struct MemoryArena mem_arena_t;
+
+typedef struct {
+	void* chunk;
+	size_t used;
+} mem_arena_mark_t;
+
+#define MEM_ARENA_DEFAULT_CHUNK_SIZE (64U * 1024U)
+
+extern mem_arena_t*
+mem_ArenaCreate(size_t chunkSize);
+
+extern void
+mem_ArenaFree(mem_arena_t* arena);
+
+extern void*
+mem_ArenaAlloc(mem_arena_t* arena, size_t size);
+
+/* Grow or shrink a block allocated from the arena. The block is resized in place if it is the most recent
+ * allocation and there is room in the current chunk, otherwise the contents are copied to a new block. */
+extern void*
+mem_ArenaRealloc(mem_arena_t* arena, void* memory, size_t oldSize, size_t newSize);
+
+extern mem_arena_mark_t
+mem_ArenaMark(mem_arena_t* arena);
+
+/* Release everything allocated from the arena since the mark was recorded */
+extern void
+mem_ArenaRollback(mem_arena_t* arena, mem_arena_mark_t mark);
+
+/* Number of bytes handed out by the arena, not including chunk overhead */
+extern size_t
+mem_ArenaUsage(mem_arena_t* arena);
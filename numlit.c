@@ -0,0 +1,223 @@
+/*  Copyright 2008-2026 Carsten Elton Sorensen
+
+    This file is part of ASMotor.
+
+    ASMotor is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ASMotor is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ASMotor.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+
+#include "numlit.h"
+#include "util.h"
+
+// Runs of eight decimal or binary digits are converted a word at a time, which relies on the first character
+// ending up in the lowest byte of the word
+#if (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) || defined(_M_X64) || defined(_M_IX86)     \
+    || defined(_M_ARM64)
+#define SWAR_DIGITS
+#endif
+
+// The value of each character as a digit, 0xFF for characters that are not digits in any base
+static const uint8_t g_digitValue[256] = {
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
+
+#if defined(SWAR_DIGITS)
+#define DIGIT_ONES 0x0101010101010101ULL
+
+INLINE uint64_t
+readWord(const char* text) {
+	uint64_t word;
+	memcpy(&word, text, sizeof(word));
+	return word;
+}
+
+INLINE bool
+eightDecimalDigits(uint64_t word) {
+	return ((word & (0xF0 * DIGIT_ONES)) | (((word + 0x06 * DIGIT_ONES) & (0xF0 * DIGIT_ONES)) >> 4U)) == 0x33 * DIGIT_ONES;
+}
+
+// Combine pairs of digits, then pairs of pairs and finally the two halves
+INLINE uint32_t
+eightDecimalValue(uint64_t word) {
+	word -= 0x30 * DIGIT_ONES;
+	word = word * 10 + (word >> 8U);
+	word = (((word & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32U)))
+	        + (((word >> 16U) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32U))))
+	       >> 32U;
+	return (uint32_t) word;
+}
+
+INLINE bool
+eightBinaryDigits(uint64_t word) {
+	return (word & (0xFE * DIGIT_ONES)) == 0x30 * DIGIT_ONES;
+}
+
+// Gather the low bit of each byte into the top byte, the first character ending up in the most significant bit
+INLINE uint32_t
+eightBinaryValue(uint64_t word) {
+	return (uint32_t) (((word & DIGIT_ONES) * 0x8040201008040201ULL) >> 56U);
+}
+#endif
+
+size_t
+numlit_ParseDigits(const char* text, size_t length, uint32_t base, uint64_t* result, bool* overflow) {
+	uint64_t value = 0;
+	bool overflowed = false;
+	size_t i = 0;
+
+#if defined(SWAR_DIGITS)
+	if (base == 10) {
+		for (; i + 8 <= length; i += 8) {
+			uint64_t word = readWord(text + i);
+			if (!eightDecimalDigits(word))
+				break;
+
+			uint32_t chunk = eightDecimalValue(word);
+			if (value > (UINT64_MAX - chunk) / 100000000U)
+				overflowed = true;
+			value = value * 100000000U + chunk;
+		}
+	} else if (base == 2) {
+		for (; i + 8 <= length; i += 8) {
+			uint64_t word = readWord(text + i);
+			if (!eightBinaryDigits(word))
+				break;
+
+			if (value >> 56U != 0)
+				overflowed = true;
+			value = (value << 8U) | eightBinaryValue(word);
+		}
+	}
+#endif
+
+	uint64_t limit = UINT64_MAX / base;
+	for (; i < length; ++i) {
+		uint32_t digit = g_digitValue[(uint8_t) text[i]];
+		if (digit >= base)
+			break;
+
+		if (value > limit || value * base > UINT64_MAX - digit)
+			overflowed = true;
+		value = value * base + digit;
+	}
+
+	*result = value;
+	*overflow = overflowed;
+	return i;
+}
+
+// The base selected by a prefix, and the length of the prefix
+static uint32_t
+literalBase(const char* text, size_t length, size_t* prefixLength) {
+	*prefixLength = 1;
+	if (length >= 1) {
+		switch (text[0]) {
+			case '$':
+				return 16;
+			case '%':
+				return 2;
+			case '&':
+				return 8;
+		}
+	}
+
+	*prefixLength = 2;
+	if (length >= 2 && text[0] == '0') {
+		switch (text[1]) {
+			case 'x':
+			case 'X':
+				return 16;
+			case 'b':
+			case 'B':
+				return 2;
+			case 'o':
+			case 'O':
+				return 8;
+		}
+	}
+
+	*prefixLength = 0;
+	return 10;
+}
+
+size_t
+numlit_Parse(const char* text, size_t length, uint64_t* result, bool* overflow) {
+	size_t prefixLength;
+	uint32_t base = literalBase(text, length, &prefixLength);
+
+	size_t consumed = numlit_ParseDigits(text + prefixLength, length - prefixLength, base, result, overflow);
+	if (consumed == 0) {
+		if (prefixLength == 2)
+			return numlit_ParseDigits(text, 1, 10, result, overflow);
+		return 0;
+	}
+
+	return prefixLength + consumed;
+}
+
+static const char*
+skipSpace(const char* text) {
+	while (*text == ' ' || (*text >= '\t' && *text <= '\r'))
+		++text;
+	return text;
+}
+
+bool
+hexToInt(const char* text, uint32_t* result) {
+	text = skipSpace(text);
+	if (text[0] == '0' && (text[1] == 'x' || text[1] == 'X') && g_digitValue[(uint8_t) text[2]] < 16)
+		text += 2;
+
+	uint64_t value;
+	bool overflow;
+	if (numlit_ParseDigits(text, strlen(text), 16, &value, &overflow) == 0 || overflow || value > UINT32_MAX)
+		return false;
+
+	*result = (uint32_t) value;
+	return true;
+}
+
+bool
+decimalToInt(const char* text, int32_t* result) {
+	text = skipSpace(text);
+	bool negative = *text == '-';
+	if (*text == '-' || *text == '+')
+		++text;
+
+	uint64_t value;
+	bool overflow;
+	if (numlit_ParseDigits(text, strlen(text), 10, &value, &overflow) == 0 || overflow
+	    || value > (negative ? (uint64_t) INT32_MAX + 1 : (uint64_t) INT32_MAX)) {
+		return false;
+	}
+
+	*result = negative ? (int32_t) (0 - (uint32_t) value) : (int32_t) value;
+	return true;
+}
@@ -0,0 +1,51 @@
+/*  Copyright 2008-2026 Carsten Elton Sorensen
+
+    This file is part of ASMotor.
+
+    ASMotor is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ASMotor is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ASMotor.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * INTEGER LITERALS
+ *
+ * Parsing of unsigned integer literals in base 2, 8, 10 and 16, independent of the locale. The text is given with a
+ * length and does not need to be zero terminated. Parsing stops at the first character that is not a digit, and the
+ * functions return the number of characters consumed, or 0 when the text does not start with a literal. A value that
+ * does not fit in 64 bits sets *overflow, and *result then holds the low 64 bits.
+ */
+
+/* Parse the digits of a literal in the given base, without a prefix */
+extern size_t
+numlit_ParseDigits(const char* text, size_t length, uint32_t base, uint64_t* result, bool* overflow);
+
+/* Parse a literal whose prefix selects the base: $ or 0x for hexadecimal, % or 0b for binary, & or 0o for octal and
+ * decimal otherwise. A 0x, 0b or 0o prefix not followed by a digit is parsed as the decimal 0. */
+extern size_t
+numlit_Parse(const char* text, size_t length, uint64_t* result, bool* overflow);
+
+/* Parse a zero terminated hexadecimal number, optionally preceded by white space and 0x. Returns false if there are
+ * no digits or the value does not fit in 32 bits. */
+extern bool
+hexToInt(const char* text, uint32_t* result);
+
+/* Parse a zero terminated decimal number, optionally preceded by white space and a sign. Returns false if there are
+ * no digits or the value does not fit in 32 bits. */
+extern bool
+decimalToInt(const char* text, int32_t* result);
@@ -42,6 +42,7 @@ typedef struct Set {
 	hash_t hash;
 	free_t free;
 	intptr_t userData;
+	mem_arena_t* arena;
 	SListEntry lists[SET_HASH_SIZE];
 	vec_t* subSets;
 } set_t;
@@ -53,13 +54,13 @@ vec_set_free(intptr_t userData, intptr_t element) {
 	set_Free((set_t*) element);
 }
 
-extern set_t*
-set_Create(equals_t equals, hash_t hash, free_t free) {
-	set_t* set = (set_t*) mem_Alloc(sizeof(set_t));
+static set_t*
+initSet(set_t* set, mem_arena_t* arena, equals_t equals, hash_t hash, free_t free) {
 	set->equals = equals;
 	set->hash = hash;
 	set->free = free;
-	set->subSets = vec_Create(vec_set_free);
+	set->arena = arena;
+	set->subSets = arena != NULL ? vec_CreateArena(arena, vec_set_free) : vec_Create(vec_set_free);
 
 	for (uint32_t i = 0; i < SET_HASH_SIZE; ++i) {
 		set->lists[i].allocatedElements = 0;
@@ -70,6 +71,16 @@ set_Create(equals_t equals, hash_t hash, free_t free) {
 	return set;
 }
 
+extern set_t*
+set_Create(equals_t equals, hash_t hash, free_t free) {
+	return initSet((set_t*) mem_Alloc(sizeof(set_t)), NULL, equals, hash, free);
+}
+
+extern set_t*
+set_CreateArena(mem_arena_t* arena, equals_t equals, hash_t hash, free_t free) {
+	return initSet((set_t*) mem_ArenaAlloc(arena, sizeof(set_t)), arena, equals, hash, free);
+}
+
 static uint32_t
 hashElement(set_t* set, intptr_t element) {
 	return set->hash(set->userData, element) % SET_HASH_SIZE;
@@ -153,8 +164,14 @@ set_Insert(set_t* set, intptr_t element) {
 	}
 
 	if (list->elements == NULL || list->allocatedElements == list->totalElements) {
+		uint32_t oldElements = list->allocatedElements;
 		list->allocatedElements = list->allocatedElements * 2 + 4;
-		list->elements = mem_Realloc(list->elements, list->allocatedElements * sizeof(void*));
+		if (set->arena != NULL) {
+			list->elements = mem_ArenaRealloc(set->arena, list->elements, oldElements * sizeof(void*),
+			                                  list->allocatedElements * sizeof(void*));
+		} else {
+			list->elements = mem_Realloc(list->elements, list->allocatedElements * sizeof(void*));
+		}
 	}
 	list->elements[list->totalElements++] = element;
 }
@@ -234,7 +251,8 @@ set_Clear(set_t* set) {
 			for (uint32_t j = 0; j < list->totalElements; ++j) {
 				set->free(set->userData, list->elements[j]);
 			}
-			mem_Free(list->elements);
+			if (set->arena == NULL)
+				mem_Free(list->elements);
 		}
 		list->elements = NULL;
 		list->allocatedElements = 0;
@@ -254,10 +272,12 @@ set_Free(set_t* set) {
 			for (uint32_t j = 0; j < list->totalElements; ++j) {
 				set->free(set->userData, list->elements[j]);
 			}
-			mem_Free(list->elements);
+			if (set->arena == NULL)
+				mem_Free(list->elements);
 		}
 	}
-	mem_Free(set);
+	if (set->arena == NULL)
+		mem_Free(set);
 }
 
 static void
@@ -309,7 +329,8 @@ set_GetUserData(set_t* set) {
 
 extern set_t*
 set_CreateSubSet(set_t* set) {
-	set_t* subSet = set_Create(set->equals, set->hash, set->free);
+	set_t* subSet = set->arena != NULL ? set_CreateArena(set->arena, set->equals, set->hash, set->free)
+	                                   : set_Create(set->equals, set->hash, set->free);
 	vec_PushBack(set->subSets, (intptr_t) subSet);
 	return subSet;
 }
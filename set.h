@@ -35,6 +35,10 @@ typedef bool (*predicate_t)(set_t* set, intptr_t userData, intptr_t predicateDat
 extern set_t*
 set_Create(equals_t equals, hash_t hash, free_t free);
 
+/* Create a set whose control block and hash lists are allocated from an arena */
+extern set_t*
+set_CreateArena(mem_arena_t* arena, equals_t equals, hash_t hash, free_t free);
+
 extern void
 set_Clear(set_t* set);
 
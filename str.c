@@ -17,22 +17,130 @@
 */
 
 #include <assert.h>
-#include <ctype.h>
 #include <stdarg.h>
 #include <string.h>
 
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
 #include "mem.h"
 #include "str.h"
-#include "strbuf.h"
 #include "util.h"
 
-typedef struct {
-	uint32_t refCount;
-	ssize_t length;
-	char data[1];
-} empty_string;
+STR_STATIC(g_emptyString, "");
+
+#if !defined(_DEBUG) && !defined(ASMOTOR_NO_STRING_POOL)
+#define STRING_POOL
+#endif
+
+#if defined(STRING_POOL)
+// Short strings are carved from fixed size cells in pages shared by all strings, rather than each being a separate
+// heap block. Freed cells are kept on a free list per cell size, and the pages are never released. Debug builds
+// allocate every string individually so leaks are reported with their call site.
+
+#define POOL_CLASSES      2U
+#define POOL_SMALL_CELL   32U
+#define POOL_LARGE_CELL   64U
+#define POOL_PAGE_SIZE    (16U * 1024U)
+#define POOL_LARGE_STRING 0x8000U
+
+typedef struct PoolCell {
+	struct PoolCell* next;
+} SPoolCell;
+
+#if defined(ASMOTOR_THREADSAFE_MEMORY)
+// Each thread has its own free lists. A thread releasing its caches moves its cells to a shared depot, which a thread
+// whose list runs dry takes in full before allocating a new page. Cells are only ever taken from the depot all at
+// once, so pushing with a compare and swap of the head is not subject to the ABA problem.
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define DEPOT_PEEK(depot) (*(depot))
+#define DEPOT_TAKE(depot) ((SPoolCell*) _InterlockedExchangePointer((void* volatile*) (depot), NULL))
+#define DEPOT_PUSH(depot, head, cells)                                                                                 \
+	(_InterlockedCompareExchangePointer((void* volatile*) (depot), cells, head) == (void*) (head))
+#else
+#define DEPOT_PEEK(depot)              __atomic_load_n(depot, __ATOMIC_RELAXED)
+#define DEPOT_TAKE(depot)              __atomic_exchange_n(depot, NULL, __ATOMIC_ACQUIRE)
+#define DEPOT_PUSH(depot, head, cells)                                                                                 \
+	__atomic_compare_exchange_n(depot, &(head), cells, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED)
+#endif
 
-static empty_string g_emptyString = {1, 0, ""};
+static THREAD_LOCAL SPoolCell* t_poolCells[POOL_CLASSES];
+static SPoolCell* volatile g_poolDepot[POOL_CLASSES];
+
+void
+str_ReleaseThreadPool(void) {
+	for (uint32_t poolClass = 0; poolClass < POOL_CLASSES; ++poolClass) {
+		SPoolCell* cells = t_poolCells[poolClass];
+		if (cells == NULL)
+			continue;
+
+		SPoolCell* last = cells;
+		while (last->next != NULL)
+			last = last->next;
+
+		SPoolCell* head = DEPOT_PEEK(&g_poolDepot[poolClass]);
+		do {
+			last->next = head;
+		} while (!DEPOT_PUSH(&g_poolDepot[poolClass], head, cells));
+
+		t_poolCells[poolClass] = NULL;
+	}
+}
+#else
+static SPoolCell* t_poolCells[POOL_CLASSES];
+#endif
+
+static SPoolCell*
+refillPool(uint32_t poolClass, size_t cellSize) {
+#if defined(ASMOTOR_THREADSAFE_MEMORY)
+	if (DEPOT_PEEK(&g_poolDepot[poolClass]) != NULL) {
+		SPoolCell* cells = DEPOT_TAKE(&g_poolDepot[poolClass]);
+		if (cells != NULL)
+			return t_poolCells[poolClass] = cells;
+	}
+#endif
+
+	uint8_t* page = mem_Alloc(POOL_PAGE_SIZE);
+	SPoolCell* cells = NULL;
+	for (size_t offset = POOL_PAGE_SIZE - cellSize; offset < POOL_PAGE_SIZE; offset -= cellSize) {
+		SPoolCell* cell = (SPoolCell*) (page + offset);
+		cell->next = cells;
+		cells = cell;
+	}
+	return t_poolCells[poolClass] = cells;
+}
+
+INLINE string*
+poolAlloc(ssize_t length) {
+	uint32_t poolClass = sizeof(string) + length + 1 > POOL_SMALL_CELL;
+	SPoolCell* cell = t_poolCells[poolClass];
+	if (cell == NULL)
+		cell = refillPool(poolClass, poolClass != 0 ? POOL_LARGE_CELL : POOL_SMALL_CELL);
+
+	t_poolCells[poolClass] = cell->next;
+
+	string* str = (string*) cell;
+	str->length = (uint32_t) length;
+	str->refCount = 1;
+	str->flags = poolClass != 0 ? STR_POOLED | POOL_LARGE_STRING : STR_POOLED;
+	str->hash = 0;
+	return str;
+}
+
+INLINE void
+poolFree(string* str) {
+	uint32_t poolClass = (str->flags & POOL_LARGE_STRING) != 0;
+	SPoolCell* cell = (SPoolCell*) str;
+	cell->next = t_poolCells[poolClass];
+	t_poolCells[poolClass] = cell;
+}
+#elif defined(ASMOTOR_THREADSAFE_MEMORY)
+void
+str_ReleaseThreadPool(void) {}
+#endif
 
 static char
 createSpace(void) {
@@ -61,10 +169,16 @@ str_AllocDebug(ssize_t length, const char* file, int lineNumber) {
 	string* pString = mem_AllocImpl(sizeof(string) + length + 1, file, lineNumber);
 #else
 str_Alloc(ssize_t length) {
+#if defined(STRING_POOL)
+	if (sizeof(string) + length + 1 <= POOL_LARGE_CELL)
+		return poolAlloc(length);
+#endif
 	string* pString = mem_Alloc(sizeof(string) + length + 1);
 #endif
 	pString->length = (uint32_t) length;
 	pString->refCount = 1;
+	pString->flags = 0;
+	pString->hash = 0;
 	return pString;
 }
 
@@ -83,6 +197,20 @@ str_CreateLength(const char* data, size_t length) {
 	return str;
 }
 
+string*
+str_CreateLengthArena(mem_arena_t* arena, const char* data, size_t length) {
+	string* str = mem_ArenaAlloc(arena, sizeof(string) + length + 1);
+	str->length = (uint32_t) length;
+	str->refCount = STR_IMMORTAL_REFCOUNT;
+	str->flags = 0;
+	str->hash = 0;
+	if (data != NULL) {
+		memcpy(str->data, data, length);
+	}
+	str->data[length] = 0;
+	return str;
+}
+
 string*
 #if defined(_DEBUG)
 str_CreateStreamDebug(char (*nextChar)(void), size_t length, const char* filename, int lineNumber) {
@@ -104,16 +232,24 @@ str_CreateArgsDebug(const char* filename, int lineNumber, const char* format, va
 #else
 str_CreateArgs(const char* format, va_list args) {
 #endif
-	string_buffer* buf = strbuf_Create();
-	strbuf_AppendArgs(buf, format, args);
+	// Short results are formatted on the stack and copied, longer ones formatted again into the string
+	char local[256];
+	va_list copy;
+	va_copy(copy, args);
+	size_t length = str_FormatArgs(local, sizeof(local), format, args);
 
 #if defined(_DEBUG)
-	string* result = strbuf_StringDebug(buf, filename, lineNumber);
+	string* result = str_AllocDebug(length, filename, lineNumber);
 #else
-	string* result = strbuf_String(buf);
+	string* result = str_Alloc(length);
 #endif
 
-	strbuf_Free(buf);
+	if (length < sizeof(local))
+		memcpy(result->data, local, length + 1);
+	else
+		str_FormatArgs(result->data, length + 1, format, copy);
+
+	va_end(copy);
 	return result;
 }
 
@@ -137,7 +273,7 @@ str_CreateFormat(const char* format, ...) {
 
 string*
 str_Empty(void) {
-	return _str_Ref((string*) &g_emptyString);
+	return _str_Ref(g_emptyString);
 }
 
 void
@@ -145,9 +281,116 @@ str_Free(string* str) {
 	if (str != NULL) {
 		assert(str->refCount != 0);
 
-		if (--str->refCount == 0)
+		if (--str->refCount == 0) {
+#if defined(STRING_POOL)
+			if (str->flags & STR_POOLED) {
+				poolFree(str);
+				return;
+			}
+#endif
 			mem_Free(str);
+		}
+	}
+}
+
+// String interning. The table is open addressed with linear probing, and holds a reference to each interned string.
+
+typedef struct {
+	uint32_t hash;
+	string* str;
+} SInternEntry;
+
+static SInternEntry* g_internTable = NULL;
+static size_t g_internCapacity = 0;
+static size_t g_internCount = 0;
+
+static void
+growInternTable(void) {
+	size_t capacity = g_internCapacity == 0 ? 1024 : g_internCapacity * 2;
+	SInternEntry* table = mem_Alloc(capacity * sizeof(SInternEntry));
+	memset(table, 0, capacity * sizeof(SInternEntry));
+
+	for (size_t i = 0; i < g_internCapacity; ++i) {
+		SInternEntry* entry = &g_internTable[i];
+		if (entry->str != NULL) {
+			size_t index = entry->hash & (capacity - 1);
+			while (table[index].str != NULL)
+				index = (index + 1) & (capacity - 1);
+			table[index] = *entry;
+		}
+	}
+
+	mem_Free(g_internTable);
+	g_internTable = table;
+	g_internCapacity = capacity;
+}
+
+// Find the entry holding a string, or the empty entry it should be stored in
+static SInternEntry*
+findInternEntry(const char* data, size_t length, uint32_t hash) {
+	if (g_internCount * 2 >= g_internCapacity)
+		growInternTable();
+
+	size_t index = hash & (g_internCapacity - 1);
+	while (g_internTable[index].str != NULL) {
+		SInternEntry* entry = &g_internTable[index];
+		if (entry->hash == hash && str_Length(entry->str) == length && memcmp(str_String(entry->str), data, length) == 0)
+			return entry;
+		index = (index + 1) & (g_internCapacity - 1);
+	}
+	return &g_internTable[index];
+}
+
+static string*
+internEntry(SInternEntry* entry, uint32_t hash, string* str) {
+	str->flags |= STR_INTERNED;
+	entry->hash = hash;
+	entry->str = str;
+	++g_internCount;
+	return _str_Ref(str);
+}
+
+string*
+str_Intern(const string* str) {
+	if (str->flags & STR_INTERNED)
+		return _str_Ref(str);
+
+	uint32_t hash = str_Hash(str);
+	SInternEntry* entry = findInternEntry(str_String(str), str_Length(str), hash);
+	if (entry->str != NULL)
+		return _str_Ref(entry->str);
+
+	// Arena strings only live as long as their arena, so the table keeps its own copy
+	if (str->refCount >= STR_IMMORTAL_REFCOUNT)
+		return internEntry(entry, hash, str_CreateLength(str_String(str), str_Length(str)));
+
+	return internEntry(entry, hash, _str_Ref(str));
+}
+
+string*
+str_InternLength(const char* data, size_t length) {
+	uint32_t hash = str_HashLength(data, length);
+	SInternEntry* entry = findInternEntry(data, length, hash);
+	if (entry->str != NULL)
+		return _str_Ref(entry->str);
+
+	return internEntry(entry, hash, str_CreateLength(data, length));
+}
+
+void
+str_InternFree(void) {
+	for (size_t i = 0; i < g_internCapacity; ++i) {
+		string* str = g_internTable[i].str;
+		if (str != NULL) {
+			str->flags &= ~STR_INTERNED;
+			str_Free(str);
+		}
 	}
+
+	mem_Free(g_internTable);
+	g_internTable = NULL;
+	g_internCapacity = 0;
+	g_internCount = 0;
 }
 
 string*
@@ -172,6 +415,160 @@ str_Concat(const string* str1, const string* str2) {
 	return newString;
 }
 
+// Copy the strings and the separators between them to dest, which is then zero terminated
+static void
+joinStrings(char* dest, const char* separator, size_t separatorLength, const string* const* strings, size_t count) {
+	for (size_t i = 0; i < count; ++i) {
+		if (i != 0 && separatorLength != 0) {
+			memcpy(dest, separator, separatorLength);
+			dest += separatorLength;
+		}
+		if (strings[i] != NULL) {
+			memcpy(dest, str_String(strings[i]), str_Length(strings[i]));
+			dest += str_Length(strings[i]);
+		}
+	}
+	*dest = 0;
+}
+
+string*
+#if defined(_DEBUG)
+str_JoinDebug(const char* separator, const string* const* strings, size_t count, const char* file, int lineNumber) {
+#else
+str_Join(const char* separator, const string* const* strings, size_t count) {
+#endif
+	if (count == 1 && strings[0] != NULL)
+		return _str_Ref(strings[0]);
+
+	size_t separatorLength = separator != NULL ? strlen(separator) : 0;
+	size_t length = count > 1 ? separatorLength * (count - 1) : 0;
+	for (size_t i = 0; i < count; ++i) {
+		if (strings[i] != NULL)
+			length += str_Length(strings[i]);
+	}
+
+#if defined(_DEBUG)
+	string* result = str_AllocDebug(length, file, lineNumber);
+#else
+	string* result = str_Alloc(length);
+#endif
+	joinStrings(result->data, separator, separatorLength, strings, count);
+	return result;
+}
+
+string*
+#if defined(_DEBUG)
+str_JoinListDebug(const char* file, int lineNumber, const char* separator, ...) {
+#else
+str_JoinList(const char* separator, ...) {
+#endif
+	va_list args;
+	va_start(args, separator);
+
+	// The first pass counts the strings and their length, the second copies them
+	va_list counting;
+	va_copy(counting, args);
+	const string* first = NULL;
+	size_t count = 0;
+	size_t length = 0;
+	const string* str;
+	while ((str = va_arg(counting, const string*)) != NULL) {
+		first = count == 0 ? str : first;
+		length += str_Length(str);
+		++count;
+	}
+	va_end(counting);
+
+	if (count == 1) {
+		va_end(args);
+		return _str_Ref(first);
+	}
+
+	size_t separatorLength = separator != NULL ? strlen(separator) : 0;
+	length += count > 1 ? separatorLength * (count - 1) : 0;
+
+#if defined(_DEBUG)
+	string* result = str_AllocDebug(length, file, lineNumber);
+#else
+	string* result = str_Alloc(length);
+#endif
+	char* dest = result->data;
+	for (size_t i = 0; i < count; ++i) {
+		str = va_arg(args, const string*);
+		if (i != 0 && separatorLength != 0) {
+			memcpy(dest, separator, separatorLength);
+			dest += separatorLength;
+		}
+		memcpy(dest, str_String(str), str_Length(str));
+		dest += str_Length(str);
+	}
+	*dest = 0;
+	va_end(args);
+
+	return result;
+}
+
+// The size of the block holding a growable string. It only depends on the length, so the capacity does not need
+// to be stored in the string.
+static size_t
+growableSize(size_t length) {
+	size_t size = 32;
+	while (size < sizeof(string) + length + 1)
+		size *= 2;
+	return size;
+}
+
+void
+#if defined(_DEBUG)
+str_AppendCharsDebug(string** str, const char* data, size_t length, const char* file, int lineNumber) {
+#else
+str_AppendChars(string** str, const char* data, size_t length) {
+#endif
+	string* dest = *str;
+	if (length == 0 && dest != NULL)
+		return;
+
+	size_t oldLength = dest != NULL ? str_Length(dest) : 0;
+	size_t newLength = oldLength + length;
+	size_t newSize = growableSize(newLength);
+
+	if (dest != NULL && dest->refCount == 1 && (dest->flags & STR_GROWABLE) != 0) {
+		if (newSize != growableSize(oldLength)) {
+			bool inside = data >= dest->data && data < dest->data + oldLength;
+			size_t offset = inside ? (size_t) (data - dest->data) : 0;
+#if defined(_DEBUG)
+			dest = mem_ReallocImpl(dest, newSize, file, lineNumber);
+#else
+			dest = mem_Realloc(dest, newSize);
+#endif
+			if (inside)
+				data = dest->data + offset;
+		}
+		memcpy(dest->data + oldLength, data, length);
+	} else {
+#if defined(_DEBUG)
+		string* grown = mem_AllocImpl(newSize, file, lineNumber);
+#else
+		string* grown = mem_Alloc(newSize);
+#endif
+		grown->refCount = 1;
+		grown->flags = STR_GROWABLE;
+		if (dest != NULL)
+			memcpy(grown->data, dest->data, oldLength);
+		if (length != 0)
+			memcpy(grown->data + oldLength, data, length);
+
+		// data may be part of the original, so it is only released after copying
+		str_Free(dest);
+		dest = grown;
+	}
+
+	dest->length = (uint32_t) newLength;
+	dest->hash = 0;
+	dest->data[newLength] = 0;
+	*str = dest;
+}
+
 string*
 #if defined(_DEBUG)
 str_SliceDebug(const string* str1, ssize_t index, ssize_t length, const char* file, int lineNumber) {
@@ -194,24 +591,49 @@ str_Slice(const string* str1, ssize_t index, ssize_t length) {
 #endif
 }
 
+static uint32_t
+foundIndex(const string* haystack, const char* p) {
+	return p != NULL ? (uint32_t) (p - str_String(haystack)) : UINT32_MAX;
+}
+
 uint32_t
 str_Find(const string* haystack, const string* needle) {
-	char* p = strstr(str_String(haystack), str_String(needle));
-	if (p != NULL) {
-		return (uint32_t) (p - str_String(haystack));
-	} else {
+	return str_FindFrom(haystack, needle, 0);
+}
+
+uint32_t
+str_FindFrom(const string* haystack, const string* needle, size_t offset) {
+	if (offset > str_Length(haystack))
 		return UINT32_MAX;
-	}
+
+	const char* p = str_FindBytes(str_String(haystack) + offset, str_Length(haystack) - offset, str_String(needle),
+	                              str_Length(needle));
+	return foundIndex(haystack, p);
+}
+
+uint32_t
+str_FindLast(const string* haystack, const string* needle) {
+	const char* p = str_FindLastBytes(str_String(haystack), str_Length(haystack), str_String(needle),
+	                                  str_Length(needle));
+	return foundIndex(haystack, p);
 }
 
 uint32_t
 str_FindChar(const string* haystack, char needle) {
-	char* p = strchr(str_String(haystack), needle);
-	if (p != NULL) {
-		return (uint32_t) (p - str_String(haystack));
-	} else {
+	return foundIndex(haystack, str_FindByte(str_String(haystack), str_Length(haystack), needle));
+}
+
+uint32_t
+str_FindCharFrom(const string* haystack, char needle, size_t offset) {
+	if (offset >= str_Length(haystack))
 		return UINT32_MAX;
-	}
+
+	return foundIndex(haystack, str_FindByte(str_String(haystack) + offset, str_Length(haystack) - offset, needle));
+}
+
+uint32_t
+str_FindLastChar(const string* haystack, char needle) {
+	return foundIndex(haystack, str_FindLastByte(str_String(haystack), str_Length(haystack), needle));
 }
 
 bool
@@ -222,6 +644,10 @@ str_Equal(const string* str1, const string* str2) {
 	if (str1 == NULL || str2 == NULL)
 		return false;
 
+	// There is only one interned string with any given contents
+	if (str1->flags & str2->flags & STR_INTERNED)
+		return false;
+
 	size_t length1 = str_Length(str1);
 
 	if (length1 != str_Length(str2))
@@ -235,17 +661,34 @@ str_Compare(const string* str1, const string* str2) {
 	return strcmp(str_String(str1), str_String(str2));
 }
 
+bool
+str_EqualI(const string* str1, const string* str2) {
+	if (str1 == str2)
+		return true;
+
+	size_t length1 = str_Length(str1);
+	return length1 == str_Length(str2) && str_EqualBytesI(str_String(str1), str_String(str2), length1);
+}
+
+int
+str_CompareI(const string* str1, const string* str2) {
+	return str_CompareBytesI(str_String(str1), str_Length(str1), str_String(str2), str_Length(str2));
+}
+
 	bool
 str_EqualConst(const string* str1, const char* str2) {
-	if (!str1 || !str2)
+	if (!str2)
 		return false;
 
-	ssize_t length1 = str_Length(str1);
-	if (strlen(str2) != (size_t) length1) {
+	return str_EqualChars(str1, str2, strlen(str2));
+}
+
+bool
+str_EqualChars(const string* str1, const char* data, size_t length) {
+	if (!str1)
 		return false;
-	}
 
-	return memcmp(str_String(str1), str2, length1) == 0;
+	return str_Length(str1) == length && memcmp(str_String(str1), data, length) == 0;
 }
 
 bool
@@ -301,9 +744,7 @@ str_ToLower(const string* str) {
 	string* pLowerString = str_Alloc(length);
 #endif
 
-	for (ssize_t i = 0; i < length; ++i) {
-		str_Set(pLowerString, i, (char) tolower(str_CharAt(str, i)));
-	}
+	str_ToLowerBytes(pLowerString->data, str_String(str), length);
 	str_Set(pLowerString, length, 0);
 
 	return pLowerString;
@@ -312,6 +753,7 @@ str_ToLower(const string* str) {
 void
 str_TransformReplace(string** str, char (*transform)(char)) {
 	copyOnWrite(str);
+	(*str)->hash = 0;
 
 	ssize_t len = str_Length(*str);
 	for (ssize_t i = 0; i < len; ++i) {
@@ -319,24 +761,18 @@ str_TransformReplace(string** str, char (*transform)(char)) {
 	}
 }
 
-INLINE char
-charToUpper(char ch) {
-	return (char) toupper(ch);
-}
-
-INLINE char
-charToLower(char ch) {
-	return (char) tolower(ch);
-}
-
 void
 str_ToUpperReplace(string** str) {
-	str_TransformReplace(str, charToUpper);
+	copyOnWrite(str);
+	(*str)->hash = 0;
+	str_ToUpperBytes((*str)->data, (*str)->data, str_Length(*str));
 }
 
 void
 str_ToLowerReplace(string** str) {
-	str_TransformReplace(str, charToLower);
+	copyOnWrite(str);
+	(*str)->hash = 0;
+	str_ToLowerBytes((*str)->data, (*str)->data, str_Length(*str));
 }
 
 string*
@@ -351,28 +787,34 @@ str_CreateSpaces(uint32_t count) {
 
 string*
 str_Align(string* str, int32_t alignment) {
-	int spaceCount = abs(alignment) - (int) str_Length(str);
-	if (spaceCount > 0) {
-		string* spacesString = str_CreateSpaces(spaceCount);
-		string* aligned;
-		if (alignment < 0) {
-			aligned = str_Concat(str, spacesString);
-		} else {
-			aligned = str_Concat(spacesString, str);
-		}
-		str_Free(spacesString);
-		return aligned;
-	}
+	size_t length = str_Length(str);
+	size_t width = (size_t) abs(alignment);
+	if (width <= length)
+		return _str_Ref(str);
 
-	return _str_Ref(str);
+#if defined(_DEBUG)
+	string* aligned = str_AllocDebug(width, __FILE__, __LINE__);
+#else
+	string* aligned = str_Alloc(width);
+#endif
+	size_t spaceCount = width - length;
+	if (alignment < 0) {
+		memcpy(aligned->data, str_String(str), length);
+		memset(aligned->data + length, ' ', spaceCount);
+	} else {
+		memset(aligned->data, ' ', spaceCount);
+		memcpy(aligned->data + spaceCount, str_String(str), length);
+	}
+	aligned->data[width] = 0;
+	return aligned;
 }
 
 extern uint32_t
-str_JenkinsHashLengthI(const void* str, size_t length) {
-	uint8_t* key = (uint8_t*) str;
+str_JenkinsHashLength(const void* str, size_t length) {
+	const uint8_t* key = (const uint8_t*) str;
 	uint32_t hash = 0;
 	for (size_t i = 0; i < length; ++i) {
-		hash += key[i++];
+		hash += key[i];
 		hash += hash << 10;
 		hash ^= hash >> 6;
 	}
@@ -384,11 +826,11 @@ str_JenkinsHashLengthI(const void* str, size_t length) {
 }
 
 extern uint32_t
-str_JenkinsHashLength(const void* str, size_t length) {
-	uint8_t* key = (uint8_t*) str;
+str_JenkinsHashLengthI(const void* str, size_t length) {
+	const uint8_t* key = (const uint8_t*) str;
 	uint32_t hash = 0;
 	for (size_t i = 0; i < length; ++i) {
-		hash += toupper(key[i++]);
+		hash += (uint8_t) str_CharToUpper((char) key[i]);
 		hash += hash << 10;
 		hash ^= hash >> 6;
 	}
@@ -399,6 +841,112 @@ str_JenkinsHashLength(const void* str, size_t length) {
 	return hash;
 }
 
+// The word at a time hash follows wyhash: words are combined with a 64x64->128 bit multiply whose halves are
+// folded together
+
+#define HASH_P0 0xA0761D6478BD642FULL
+#define HASH_P1 0xE7037ED1A0B428DBULL
+#define HASH_P2 0x8EBC6AF09C88C6E3ULL
+
+#define HASH_ONES  0x0101010101010101ULL
+#define HASH_HIGHS 0x8080808080808080ULL
+
+INLINE uint64_t
+hashMix(uint64_t a, uint64_t b) {
+#if defined(__SIZEOF_INT128__)
+	unsigned __int128 product = (unsigned __int128) a * b;
+	return (uint64_t) product ^ (uint64_t) (product >> 64U);
+#elif defined(_MSC_VER) && defined(_M_X64)
+	uint64_t high;
+	uint64_t low = _umul128(a, b, &high);
+	return low ^ high;
+#else
+	uint64_t aLow = (uint32_t) a, aHigh = a >> 32U;
+	uint64_t bLow = (uint32_t) b, bHigh = b >> 32U;
+	uint64_t lowLow = aLow * bLow, lowHigh = aLow * bHigh, highLow = aHigh * bLow, highHigh = aHigh * bHigh;
+	uint64_t middle = (lowLow >> 32U) + (uint32_t) lowHigh + (uint32_t) highLow;
+	uint64_t low = (middle << 32U) | (uint32_t) lowLow;
+	uint64_t high = highHigh + (lowHigh >> 32U) + (highLow >> 32U) + (middle >> 32U);
+	return low ^ high;
+#endif
+}
+
+// Upper case the ASCII letters in a word, eight characters at a time
+INLINE uint64_t
+hashFoldCase(uint64_t word) {
+	uint64_t heptets = word & ~HASH_HIGHS;
+	uint64_t atLeastA = heptets + (0x80U - 'a') * HASH_ONES;
+	uint64_t aboveZ = heptets + (0x80U - 'z' - 1) * HASH_ONES;
+	uint64_t lower = atLeastA & ~aboveZ & ~word & HASH_HIGHS;
+	return word ^ (lower >> 2U);
+}
+
+INLINE uint64_t
+hashRead64(const uint8_t* data) {
+	uint64_t word;
+	memcpy(&word, data, sizeof(word));
+	return word;
+}
+
+INLINE uint64_t
+hashRead32(const uint8_t* data) {
+	uint32_t word;
+	memcpy(&word, data, sizeof(word));
+	return word;
+}
+
+// Strings up to 16 characters are read as two words from possibly overlapping positions, so there are no loops or
+// branches on the exact length
+INLINE uint32_t
+fastHash(const void* str, size_t length, bool foldCase) {
+	const uint8_t* data = (const uint8_t*) str;
+	uint64_t seed = HASH_P0;
+	uint64_t a, b;
+
+	if (length <= 16) {
+		if (length >= 4) {
+			size_t middle = (length >> 3U) << 2U;
+			a = (hashRead32(data) << 32U) | hashRead32(data + middle);
+			b = (hashRead32(data + length - 4) << 32U) | hashRead32(data + length - 4 - middle);
+		} else if (length > 0) {
+			a = ((uint64_t) data[0] << 16U) | ((uint64_t) data[length >> 1U] << 8U) | data[length - 1];
+			b = 0;
+		} else {
+			a = b = 0;
+		}
+	} else {
+		size_t remaining = length;
+		for (; remaining > 16; remaining -= 16, data += 16) {
+			uint64_t word1 = hashRead64(data), word2 = hashRead64(data + 8);
+			if (foldCase) {
+				word1 = hashFoldCase(word1);
+				word2 = hashFoldCase(word2);
+			}
+			seed = hashMix(word1 ^ HASH_P1, word2 ^ seed);
+		}
+		a = hashRead64(data + remaining - 16);
+		b = hashRead64(data + remaining - 8);
+	}
+
+	if (foldCase) {
+		a = hashFoldCase(a);
+		b = hashFoldCase(b);
+	}
+
+	uint64_t hash = hashMix(hashMix(a ^ HASH_P1, b ^ seed) ^ HASH_P2, (uint64_t) length ^ HASH_P1);
+	return (uint32_t) (hash ^ (hash >> 32U));
+}
+
+extern uint32_t
+str_FastHashLength(const void* str, size_t length) {
+	return fastHash(str, length, false);
+}
+
+extern uint32_t
+str_FastHashLengthI(const void* str, size_t length) {
+	return fastHash(str, length, true);
+}
+
 extern string*
 #if defined(_DEBUG)
 str_ReadFileDebug(FILE* fileHandle, size_t count, const char* filename, int lineNumber) {
@@ -418,27 +966,31 @@ str_ReadLineFromFileDebug(FILE* fileHandle, const char* file, int lineNumber) {
 #else
 str_ReadLineFromFile(FILE* fileHandle) {
 #endif
-	string_buffer* buf = strbuf_Create();
-
 	int ch = fgetc(fileHandle);
 	if (ch == EOF)
 		return NULL;
 
-	do {
-		if (ch == '\n' || ch == EOF)
-			break;
-		strbuf_AppendChar(buf, ch);
-		ch = fgetc(fileHandle);
-	} while (ch != '\n' && ch != EOF);
+	// The line is read in chunks that are appended in place, so it is not copied once complete
+	string* line = NULL;
+	char chunk[256];
+	for (;;) {
+		size_t used = 0;
+		while (ch != '\n' && ch != EOF && used < sizeof(chunk)) {
+			chunk[used++] = (char) ch;
+			ch = fgetc(fileHandle);
+		}
 
+		// An empty chunk still creates the string for an empty line
 #if defined(_DEBUG)
-	string* r = strbuf_StringDebug(buf, file, lineNumber);
+		str_AppendCharsDebug(&line, chunk, used, file, lineNumber);
 #else
-	string* r = strbuf_String(buf);
+		str_AppendChars(&line, chunk, used);
 #endif
-	strbuf_Free(buf);
+		if (ch == '\n' || ch == EOF)
+			break;
+	}
 
-	return r;
+	return line;
 }
 
 extern string*
@@ -481,51 +1033,31 @@ _strdup(const char* str) {
 
 char*
 _strupr(char* str) {
-	char* r = str;
-	while (*r) {
-		*r = (char) toupper((unsigned char) *r);
-		++r;
-	}
+	str_ToUpperBytes(str, str, strlen(str));
 	return str;
 }
 
 char*
 _strlwr(char* str) {
-	char* r = str;
-	while (*r) {
-		*r = (char) tolower((unsigned char) *r);
-		++r;
-	}
+	str_ToLowerBytes(str, str, strlen(str));
 	return str;
 }
 
+// The length of a string, but at most maxLength
+static size_t
+boundedLength(const char* str, size_t maxLength) {
+	const char* end = memchr(str, 0, maxLength);
+	return end != NULL ? (size_t) (end - str) : maxLength;
+}
+
 int
 _strnicmp(const char* string1, const char* string2, size_t length) {
-	while (*string1 && *string2 && length-- > 0) {
-		char l1 = (char) tolower((unsigned char) *string1++);
-		char l2 = (char) tolower((unsigned char) *string2++);
-
-		if (l1 != l2)
-			return l1 - l2;
-	}
-
-	if (length == 0)
-		return 0;
-
-	return *string1 - *string2;
+	return str_CompareBytesI(string1, boundedLength(string1, length), string2, boundedLength(string2, length));
 }
 
 int
 _stricmp(const char* string1, const char* string2) {
-	while (*string1 && *string2) {
-		char l1 = (char) tolower((unsigned char) *string1++);
-		char l2 = (char) tolower((unsigned char) *string2++);
-
-		if (l1 != l2)
-			return l1 - l2;
-	}
-
-	return *string1 - *string2;
+	return str_CompareBytesI(string1, strlen(string1), string2, strlen(string2));
 }
 
 #endif
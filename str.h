@@ -19,9 +19,12 @@
 #pragma once
 
 #include <assert.h>
+#include <stdarg.h>
 #include <stdbool.h>
 #include <string.h>
 
+#include "mem.h"
+#include "numlit.h"
 #include "util.h"
 
 #if defined(_MSC_VER)
@@ -53,11 +56,17 @@
  *   - Never assign directly to *dest — always use str_Move, str_Assign, or str_Clear.
  *   - Struct fields: initialize to NULL before using str_Assign/str_Move, free in destructor.
  *   - To get an owned copy of a borrowed string, use str_Assign.
+ *
+ * ARENA STRINGS:
+ *   - Strings created with str_CreateLengthArena live until their arena is released. They start out with
+ *     STR_IMMORTAL_REFCOUNT, so str_Free never returns them to the heap and the usual ownership rules still apply.
  */
 
 typedef struct {
 	uint32_t refCount;
 	uint32_t length;
+	uint32_t flags;
+	uint32_t hash;
 	char data[];
 } string;
 
@@ -65,6 +74,50 @@ typedef struct {
 #pragma warning(pop)
 #endif
 
+/* Reference count for strings that must never be freed. It is large enough that balanced _str_Ref/str_Free pairs
+ * never bring it to zero. */
+#define STR_IMMORTAL_REFCOUNT 0x80000000U
+
+/* String flags. Pooled strings are short strings carved from a shared pool rather than allocated individually.
+ * Interned strings are the single instance of their contents held by the intern table, see str_Intern. */
+#define STR_POOLED   0x01U
+#define STR_INTERNED 0x02U
+
+/* In ASMOTOR_THREADSAFE_MEMORY mode every thread has its own free pool cells. This moves the calling thread's cells
+ * to a depot shared by all threads, and is called by mem_ReleaseThreadCache. */
+#if defined(ASMOTOR_THREADSAFE_MEMORY)
+extern void
+str_ReleaseThreadPool(void);
+#endif
+
+/* Growable strings are allocated with room to be appended to in place, see str_AppendChars */
+#define STR_GROWABLE 0x04U
+
+/* Statically initialized strings. STR_STATIC declares a string with the contents of a string literal, its length
+ * computed by the compiler, and STR_LITERAL is the same as an expression. Neither allocates, and they have
+ * STR_IMMORTAL_REFCOUNT so they can be passed to _str_Ref, str_Assign and str_Free like any other string. The hash
+ * is computed on first use and kept in the string. At block scope STR_LITERAL only lives until the end of the block.
+ *
+ *   STR_STATIC(s_macroKeyword, "MACRO");
+ *   static const string* const s_sections[] = {STR_LITERAL("CODE"), STR_LITERAL("DATA"), STR_LITERAL("BSS")};
+ */
+#define STR_STATIC_TYPE(literal)                                                                                       \
+	struct {                                                                                                           \
+		uint32_t refCount;                                                                                             \
+		uint32_t length;                                                                                               \
+		uint32_t flags;                                                                                                \
+		uint32_t hash;                                                                                                 \
+		char data[sizeof(literal)];                                                                                    \
+	}
+
+#define STR_STATIC_INIT(literal) {STR_IMMORTAL_REFCOUNT, sizeof(literal) - 1, 0, 0, literal}
+
+#define STR_STATIC(name, literal)                                                                                      \
+	static STR_STATIC_TYPE(literal) name##_static = STR_STATIC_INIT(literal);                                          \
+	static string* const name = (string*) &name##_static
+
+#define STR_LITERAL(literal) ((string*) &(STR_STATIC_TYPE(literal)) STR_STATIC_INIT(literal))
+
 #if defined(_MSC_VER)
 #define strncpy(dest, src, len) strncpy_s(dest, len, src, len)
 #endif
@@ -77,6 +130,14 @@ str_CreateLengthDebug(const char* data, size_t length, const char* file, int lin
 str_CreateLength(const char* data, size_t length);
 #endif
 
+extern string*
+str_CreateLengthArena(mem_arena_t* arena, const char* data, size_t length);
+
+INLINE string*
+str_CreateArena(mem_arena_t* arena, const char* data) {
+	return str_CreateLengthArena(arena, data, strlen(data));
+}
+
 extern string*
 #if defined(_DEBUG)
 str_CreateStreamDebug(char (*nextChar)(void), size_t length, const char* filename, int lineNumber);
@@ -93,6 +154,23 @@ str_CreateSpacesDebug(uint32_t count, const char* filename, int lineNumber);
 str_CreateSpaces(uint32_t count);
 #endif
 
+/* Format into length bytes at dest, returning the length of the complete result like vsnprintf. The integer, character
+ * and string conversions are formatted directly, other formats are passed on to vsnprintf. args is consumed. */
+extern size_t
+str_FormatArgs(char* dest, size_t capacity, const char* format, va_list args);
+
+/* The largest number of digits written by str_FormatUnsigned, and by str_FormatHex unless minDigits is larger */
+#define STR_MAX_NUMBER_DIGITS 20
+
+/* Write a number in decimal, or in upper case hexadecimal with at least minDigits digits. Returns the number of
+ * characters written, which are not zero terminated. dest must have room for STR_MAX_NUMBER_DIGITS characters, or
+ * minDigits if that is larger. */
+extern size_t
+str_FormatUnsigned(char* dest, uint64_t value);
+
+extern size_t
+str_FormatHex(char* dest, uint64_t value, uint32_t minDigits);
+
 extern string*
 #if defined(_DEBUG)
 str_CreateArgsDebug(const char* filename, int lineNumber, const char* format, va_list args);
@@ -123,6 +201,24 @@ str_Create(const char* data) {
 extern string*
 str_Empty(void);
 
+/* Return a reference to the interned string with the same contents, interning str itself if there is none yet.
+ * Equal interned strings are the same pointer, so str_Equal compares them without looking at their contents and
+ * they can be kept in the sets and maps created by strset_CreateInterned and strmap_CreateInterned. Interned
+ * strings live until str_InternFree releases the table. The table is not synchronized. */
+extern string*
+str_Intern(const string* str);
+
+extern string*
+str_InternLength(const char* data, size_t length);
+
+INLINE string*
+str_InternConst(const char* data) {
+	return str_InternLength(data, strlen(data));
+}
+
+extern void
+str_InternFree(void);
+
 extern void
 str_Free(string* str);
 
@@ -140,6 +236,41 @@ str_ConcatDebug(const string* str1, const string* str2, const char* file, int li
 str_Concat(const string* str1, const string* str2);
 #endif
 
+/* Join count strings with a zero terminated separator between them, the separator may be NULL. The result is
+ * allocated once and each piece is copied once. NULL strings are joined as empty strings. */
+extern string*
+#if defined(_DEBUG)
+str_JoinDebug(const char* separator, const string* const* strings, size_t count, const char* file, int lineNumber);
+#define str_Join(separator, strings, count) str_JoinDebug(separator, strings, count, __FILE__, __LINE__)
+#else
+str_Join(const char* separator, const string* const* strings, size_t count);
+#endif
+
+#define str_ConcatN(strings, count) str_Join(NULL, strings, count)
+
+/* Join the strings following the separator, up to a terminating NULL */
+extern string*
+#if defined(_DEBUG)
+str_JoinListDebug(const char* file, int lineNumber, const char* separator, ...);
+#define str_JoinList(separator, ...) str_JoinListDebug(__FILE__, __LINE__, separator, __VA_ARGS__)
+#else
+str_JoinList(const char* separator, ...);
+#endif
+
+/* Append characters to a string. A string only referenced by *str is grown in place, with its capacity doubling as
+ * needed, otherwise *str is replaced by a growable copy and the reference to the original is released. *str may be
+ * NULL, and data may point into the string itself. */
+extern void
+#if defined(_DEBUG)
+str_AppendCharsDebug(string** str, const char* data, size_t length, const char* file, int lineNumber);
+#define str_AppendChars(str, data, length) str_AppendCharsDebug(str, data, length, __FILE__, __LINE__)
+#else
+str_AppendChars(string** str, const char* data, size_t length);
+#endif
+
+#define str_AppendChar(str, ch)          str_AppendChars(str, &(char) {ch}, 1)
+#define str_AppendInPlace(str, suffix)   str_AppendChars(str, str_String(suffix), str_Length(suffix))
+
 extern string*
 #if defined(_DEBUG)
 str_SliceDebug(const string* str1, ssize_t index, ssize_t length, const char* file, int lineNumber);
@@ -148,12 +279,41 @@ str_SliceDebug(const string* str1, ssize_t index, ssize_t length, const char* fi
 str_Slice(const string* str1, ssize_t index, ssize_t length);
 #endif
 
+/* Search length bytes of data for a character or a sequence of characters, returning the first or last occurrence,
+ * or NULL. Zero bytes are searched like any other. An empty needle is found at the start, or at the end when
+ * searching backwards. */
+extern const char*
+str_FindByte(const char* data, size_t length, char ch);
+
+extern const char*
+str_FindBytes(const char* data, size_t length, const char* needle, size_t needleLength);
+
+extern const char*
+str_FindLastByte(const char* data, size_t length, char ch);
+
+extern const char*
+str_FindLastBytes(const char* data, size_t length, const char* needle, size_t needleLength);
+
+/* Find the index of needle in haystack, or UINT32_MAX. The From variants begin searching at index offset, the Last
+ * variants return the last occurrence. */
 extern uint32_t
 str_Find(const string* haystack, const string* needle);
 
+extern uint32_t
+str_FindFrom(const string* haystack, const string* needle, size_t offset);
+
+extern uint32_t
+str_FindLast(const string* haystack, const string* needle);
+
 extern uint32_t
 str_FindChar(const string* haystack, char needle);
 
+extern uint32_t
+str_FindCharFrom(const string* haystack, char needle, size_t offset);
+
+extern uint32_t
+str_FindLastChar(const string* haystack, char needle);
+
 extern bool
 str_Equal(const string* str1, const string* str2);
 
@@ -163,6 +323,47 @@ str_Compare(const string* str1, const string* str2);
 extern bool
 str_EqualConst(const string* str1, const char* str2);
 
+/* Compare a string to characters given with their length, which need not be zero terminated */
+extern bool
+str_EqualChars(const string* str1, const char* data, size_t length);
+
+/* Compare a string to a string literal, whose length is known at compile time */
+#define str_EqualLiteral(str1, literal) str_EqualChars(str1, "" literal, sizeof(literal) - 1)
+
+/* ASCII case conversion, independent of the locale. str_CaseBit holds 0x20 for the letters A-Z and a-z and 0 for
+ * all other characters. */
+extern const uint8_t str_CaseBit[256];
+
+INLINE char
+str_CharToLower(char ch) {
+	return (char) (ch | str_CaseBit[(uint8_t) ch]);
+}
+
+INLINE char
+str_CharToUpper(char ch) {
+	return (char) (ch & ~str_CaseBit[(uint8_t) ch]);
+}
+
+/* Convert length characters to lower or upper case, dest may be the same as src */
+extern void
+str_ToLowerBytes(char* dest, const char* src, size_t length);
+
+extern void
+str_ToUpperBytes(char* dest, const char* src, size_t length);
+
+/* Compare characters ignoring the case of ASCII letters. Zero characters are compared like any other. */
+extern bool
+str_EqualBytesI(const char* data1, const char* data2, size_t length);
+
+extern int
+str_CompareBytesI(const char* data1, size_t length1, const char* data2, size_t length2);
+
+extern bool
+str_EqualI(const string* str1, const string* str2);
+
+extern int
+str_CompareI(const string* str1, const string* str2);
+
 extern string*
 #if defined(_DEBUG)
 str_ReplaceDebug(const string* str, char search, char replace, const char* filename, int lineNumber);
@@ -251,6 +452,7 @@ str_Move(string** dest, string** src) {
 	*src = NULL;
 }
 
+/* The Jenkins one-at-a-time hash. The I variants hash the upper case of each character. */
 extern uint32_t
 str_JenkinsHashLength(const void* str, size_t length);
 
@@ -267,6 +469,43 @@ str_JenkinsHashI(const string* str) {
 	return str_JenkinsHashLengthI(str_String(str), str_Length(str));
 }
 
+/* A hash consuming eight characters at a time, combined with a wide multiply. The I variant folds ASCII letters to
+ * upper case. */
+extern uint32_t
+str_FastHashLength(const void* str, size_t length);
+
+extern uint32_t
+str_FastHashLengthI(const void* str, size_t length);
+
+/* The hash used for strings in collections, the fast hash unless ASMOTOR_JENKINS_STRING_HASH is defined.
+ * tools/hashbench compares the two on symbol lists. */
+INLINE uint32_t
+str_HashLength(const void* str, size_t length) {
+#if defined(ASMOTOR_JENKINS_STRING_HASH)
+	return str_JenkinsHashLength(str, length);
+#else
+	return str_FastHashLength(str, length);
+#endif
+}
+
+INLINE uint32_t
+str_HashLengthI(const void* str, size_t length) {
+#if defined(ASMOTOR_JENKINS_STRING_HASH)
+	return str_JenkinsHashLengthI(str, length);
+#else
+	return str_FastHashLengthI(str, length);
+#endif
+}
+
+/* The hash of a string, as computed by str_HashLength. It is computed on first use and cached in the string,
+ * where 0 means it has not been computed yet. */
+INLINE uint32_t
+str_Hash(const string* str) {
+	if (str->hash == 0)
+		((string*) str)->hash = str_HashLength(str_String(str), str_Length(str));
+	return str->hash;
+}
+
 extern string*
 #if defined(_DEBUG)
 str_ReadFileDebug(FILE* fileHandle, size_t count, const char* file, int lineNumber);
@@ -291,25 +530,5 @@ str_CanonicalizeLineEndingsDebug(string* srcString, const char* file, int lineNu
 str_CanonicalizeLineEndings(string* srcString);
 #endif
 
-INLINE bool
-hexToInt(const char* text, uint32_t* result) {
-#if defined(_MSC_VER)
-	int count = sscanf_s(text, "%x", result);
-#else
-	int count = sscanf(text, "%x", result);
-#endif
-	return count == 1;
-}
-
-INLINE bool
-decimalToInt(const char* text, int32_t* result) {
-#if defined(_MSC_VER)
-	int count = sscanf_s(text, "%d", result);
-#else
-	int count = sscanf(text, "%d", result);
-#endif
-	return count == 1;
-}
-
 #define STR_ASSIGN(p, str) str_Assign(&(p), (str))
 #define STR_MOVE(p, str)   str_Move(&(p), &(str))
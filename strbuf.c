@@ -27,14 +27,28 @@ string_buffer*
 strbuf_Create(void) {
 	string_buffer* buffer = mem_Alloc(sizeof(string_buffer));
 	buffer->size = 0;
+	buffer->alignment = 0;
 	buffer->data = mem_Alloc(buffer->allocated = INITIAL_SIZE);
 
 	return buffer;
 }
 
+string_buffer*
+strbuf_CreateAligned(size_t alignment) {
+	string_buffer* buffer = mem_Alloc(sizeof(string_buffer));
+	buffer->size = 0;
+	buffer->alignment = alignment;
+	buffer->data = mem_AllocAligned(buffer->allocated = INITIAL_SIZE, alignment);
+
+	return buffer;
+}
+
 void
 strbuf_Free(string_buffer* buffer) {
-	mem_Free(buffer->data);
+	if (buffer->alignment != 0)
+		mem_FreeAligned(buffer->data);
+	else
+		mem_Free(buffer->data);
 	mem_Free(buffer);
 }
 
@@ -49,36 +63,44 @@ strbuf_String(string_buffer* buffer) {
 }
 
 void
-strbuf_AppendChars(string_buffer* buffer, const char* data, size_t length) {
-	if (data == NULL)
-		return;
-
+strbuf_Reserve(string_buffer* buffer, size_t length) {
 	if (length + buffer->size > buffer->allocated) {
 		size_t newSize = length + buffer->size;
 		newSize += newSize >> 1u;
 
-		buffer->data = mem_Realloc(buffer->data, newSize);
+		if (buffer->alignment != 0)
+			buffer->data = mem_ReallocAligned(buffer->data, newSize, buffer->alignment);
+		else
+			buffer->data = mem_Realloc(buffer->data, newSize);
 		buffer->allocated = newSize;
 	}
+}
 
+void
+strbuf_AppendChars(string_buffer* buffer, const char* data, size_t length) {
+	if (data == NULL)
+		return;
+
+	strbuf_Reserve(buffer, length);
 	memcpy(buffer->data + buffer->size, data, length);
 	buffer->size += length;
 }
 
+// The result is formatted straight into the spare capacity, and only formatted again when it did not fit
 void
 strbuf_AppendArgs(string_buffer* buffer, const char* format, va_list args) {
-	int sz = 80;
-	int nsz;
-	char* mem = mem_Alloc(80);
-	while (true) {
-		nsz = vsnprintf(mem, sz, format, args);
-		if (nsz >= 0 && nsz < sz)
-			break;
-		mem = mem_Realloc(mem, nsz + 1);
-		sz = nsz + 1;
+	va_list copy;
+	va_copy(copy, args);
+
+	size_t spare = buffer->allocated - buffer->size;
+	size_t length = str_FormatArgs(buffer->data + buffer->size, spare, format, args);
+	if (length >= spare) {
+		strbuf_Reserve(buffer, length + 1);
+		str_FormatArgs(buffer->data + buffer->size, length + 1, format, copy);
 	}
-	strbuf_AppendChars(buffer, mem, nsz);
-	mem_Free(mem);
+	va_end(copy);
+
+	buffer->size += length;
 }
 
 extern void
@@ -88,3 +110,25 @@ strbuf_AppendFormat(string_buffer* buffer, const char* format, ...) {
 	strbuf_AppendArgs(buffer, format, args);
 	va_end(args);
 }
+
+void
+strbuf_AppendUnsigned(string_buffer* buffer, uint64_t value) {
+	strbuf_Reserve(buffer, STR_MAX_NUMBER_DIGITS);
+	buffer->size += str_FormatUnsigned(buffer->data + buffer->size, value);
+}
+
+void
+strbuf_AppendInt(string_buffer* buffer, int64_t value) {
+	if (value < 0) {
+		strbuf_AppendChar(buffer, '-');
+		strbuf_AppendUnsigned(buffer, 0 - (uint64_t) value);
+	} else {
+		strbuf_AppendUnsigned(buffer, (uint64_t) value);
+	}
+}
+
+void
+strbuf_AppendHex(string_buffer* buffer, uint64_t value, uint32_t minDigits) {
+	strbuf_Reserve(buffer, minDigits > STR_MAX_NUMBER_DIGITS ? minDigits : STR_MAX_NUMBER_DIGITS);
+	buffer->size += str_FormatHex(buffer->data + buffer->size, value, minDigits);
+}
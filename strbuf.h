@@ -22,17 +22,23 @@
 #include <string.h>
 
 #include "str.h"
+#include "strview.h"
 #include "util.h"
 
 typedef struct {
 	size_t size;
 	size_t allocated;
+	size_t alignment;
 	char* data;
 } string_buffer;
 
 extern string_buffer*
 strbuf_Create(void);
 
+/* Create a buffer whose data is aligned to a power of two, so it can be scanned with aligned vector loads */
+extern string_buffer*
+strbuf_CreateAligned(size_t alignment);
+
 extern void
 strbuf_Free(string_buffer* buffer);
 
@@ -59,6 +65,10 @@ strbuf_StringDebug(string_buffer* buffer, const char* filename, int lineNumber);
 strbuf_String(string_buffer* buffer);
 #endif
 
+/* Make room for at least length more characters */
+extern void
+strbuf_Reserve(string_buffer* buffer, size_t length);
+
 extern void
 strbuf_AppendArgs(string_buffer* buffer, const char* format, va_list args);
 
@@ -88,3 +98,19 @@ strbuf_AppendString(string_buffer* buffer, const string* str) {
 
 	strbuf_AppendChars(buffer, str_String(str), str_Length(str));
 }
+
+INLINE void
+strbuf_AppendView(string_buffer* buffer, const string_view* view) {
+	strbuf_AppendChars(buffer, view->data, view->length);
+}
+
+/* Append a number in decimal, or in upper case hexadecimal with at least minDigits digits, without going through
+ * a format string */
+extern void
+strbuf_AppendUnsigned(string_buffer* buffer, uint64_t value);
+
+extern void
+strbuf_AppendInt(string_buffer* buffer, int64_t value);
+
+extern void
+strbuf_AppendHex(string_buffer* buffer, uint64_t value, uint32_t minDigits);
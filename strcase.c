@@ -0,0 +1,141 @@
+/*  Copyright 2008-2026 Carsten Elton Sorensen
+
+    This file is part of ASMotor.
+
+    ASMotor is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ASMotor is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ASMotor.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* ASCII case conversion and case insensitive comparison. Only the letters A-Z and a-z are affected, independent of
+ * the locale. Blocks of 16 characters are handled with SSE2 where available, and the rest through the case table. */
+
+#include <string.h>
+
+#include "str.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || (defined(__i386__) && defined(__SSE2__))
+#define SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// 0x20 for the ASCII letters, the bit that differs between their upper and lower case
+const uint8_t str_CaseBit[256] = {
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
+	0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
+	0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
+
+#if defined(SIMD_SSE2)
+// A mask of the bytes in the range first to first + 25, found with a single signed comparison after moving the
+// range to the bottom of the signed byte range
+INLINE __m128i
+letterMask(__m128i block, char first) {
+	__m128i shifted = _mm_add_epi8(block, _mm_set1_epi8((char) (0x80 - first)));
+	return _mm_cmplt_epi8(shifted, _mm_set1_epi8(-0x80 + 26));
+}
+
+INLINE __m128i
+lowerBlock(__m128i block) {
+	return _mm_or_si128(block, _mm_and_si128(letterMask(block, 'A'), _mm_set1_epi8(0x20)));
+}
+
+INLINE __m128i
+upperBlock(__m128i block) {
+	return _mm_xor_si128(block, _mm_and_si128(letterMask(block, 'a'), _mm_set1_epi8(0x20)));
+}
+#endif
+
+void
+str_ToLowerBytes(char* dest, const char* src, size_t length) {
+	size_t i = 0;
+#if defined(SIMD_SSE2)
+	for (; i + 16 <= length; i += 16) {
+		__m128i block = _mm_loadu_si128((const __m128i*) (src + i));
+		_mm_storeu_si128((__m128i*) (dest + i), lowerBlock(block));
+	}
+#endif
+	for (; i < length; ++i)
+		dest[i] = str_CharToLower(src[i]);
+}
+
+void
+str_ToUpperBytes(char* dest, const char* src, size_t length) {
+	size_t i = 0;
+#if defined(SIMD_SSE2)
+	for (; i + 16 <= length; i += 16) {
+		__m128i block = _mm_loadu_si128((const __m128i*) (src + i));
+		_mm_storeu_si128((__m128i*) (dest + i), upperBlock(block));
+	}
+#endif
+	for (; i < length; ++i)
+		dest[i] = str_CharToUpper(src[i]);
+}
+
+// The index of the first character that differs ignoring case, or length
+static size_t
+mismatchI(const char* data1, const char* data2, size_t length) {
+	size_t i = 0;
+#if defined(SIMD_SSE2)
+	for (; i + 16 <= length; i += 16) {
+		__m128i block1 = lowerBlock(_mm_loadu_si128((const __m128i*) (data1 + i)));
+		__m128i block2 = lowerBlock(_mm_loadu_si128((const __m128i*) (data2 + i)));
+		uint32_t mask = (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(block1, block2)) ^ 0xFFFFU;
+		if (mask != 0) {
+#if defined(_MSC_VER)
+			unsigned long index;
+			_BitScanForward(&index, mask);
+			return i + index;
+#else
+			return i + (size_t) __builtin_ctz(mask);
+#endif
+		}
+	}
+#endif
+	for (; i < length; ++i) {
+		if (str_CharToLower(data1[i]) != str_CharToLower(data2[i]))
+			break;
+	}
+	return i;
+}
+
+bool
+str_EqualBytesI(const char* data1, const char* data2, size_t length) {
+	return mismatchI(data1, data2, length) == length;
+}
+
+int
+str_CompareBytesI(const char* data1, size_t length1, const char* data2, size_t length2) {
+	size_t length = length1 < length2 ? length1 : length2;
+	size_t i = mismatchI(data1, data2, length);
+	if (i < length)
+		return (uint8_t) str_CharToLower(data1[i]) - (uint8_t) str_CharToLower(data2[i]);
+
+	return length1 < length2 ? -1 : length1 > length2;
+}
@@ -16,6 +16,8 @@
     along with ASMotor.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <assert.h>
+
 #include "strcoll.h"
 
 static bool
@@ -25,7 +27,7 @@ stringEquals(intptr_t userData, intptr_t element1, intptr_t element2) {
 
 static uint32_t
 stringHash(intptr_t userData, intptr_t element) {
-	return str_JenkinsHash((string*) element);
+	return str_Hash((string*) element);
 }
 
 static void
@@ -38,6 +40,20 @@ stringCopy(intptr_t userData, intptr_t element) {
 	return (intptr_t) _str_Ref((string*) element);
 }
 
+// Interned strings are equal only if they are the same string, so they can be compared and hashed by address
+
+static bool
+internedEquals(intptr_t userData, intptr_t element1, intptr_t element2) {
+	assert((((string*) element1)->flags & ((string*) element2)->flags & STR_INTERNED) != 0);
+	return element1 == element2;
+}
+
+static uint32_t
+internedHash(intptr_t userData, intptr_t element) {
+	assert((((string*) element)->flags & STR_INTERNED) != 0);
+	return (uint32_t) (((uint64_t) element * 0x9E3779B97F4A7C15ULL) >> 32U);
+}
+
 // String set functions
 
 extern set_t*
@@ -45,6 +61,16 @@ strset_Create(void) {
 	return set_Create(stringEquals, stringHash, stringFree);
 }
 
+extern set_t*
+strset_CreateArena(mem_arena_t* arena) {
+	return set_CreateArena(arena, stringEquals, stringHash, stringFree);
+}
+
+extern set_t*
+strset_CreateInterned(void) {
+	return set_Create(internedEquals, internedHash, stringFree);
+}
+
 // String map functions
 
 extern map_t*
@@ -57,6 +83,21 @@ strmap_Create(free_t valueFree) {
 #endif
 }
 
+extern map_t*
+strmap_CreateArena(mem_arena_t* arena, free_t valueFree) {
+	return map_CreateArena(arena, stringEquals, stringHash, stringFree, valueFree);
+}
+
+extern map_t*
+#if defined(_DEBUG)
+strmap_CreateInternedDebug(free_t valueFree, const char* filename, int lineNumber) {
+	return map_CreateDebug(internedEquals, internedHash, stringFree, valueFree, filename, lineNumber);
+#else
+strmap_CreateInterned(free_t valueFree) {
+	return map_Create(internedEquals, internedHash, stringFree, valueFree);
+#endif
+}
+
 // String vector functions
 
 extern vec_t*
@@ -74,7 +115,23 @@ strvec_CreateLength(size_t size) {
 	return vec_CreateLength(stringFree, size);
 }
 
+extern vec_t*
+strvec_CreateArena(mem_arena_t* arena) {
+	return vec_CreateArena(arena, stringFree);
+}
+
 extern vec_t*
 strvec_Copy(vec_t* vec) {
 	return vec_Copy(vec, stringCopy);
 }
+
+// The elements are string pointers stored as intptr_t, so the element storage is joined as an array of strings
+extern string*
+#if defined(_DEBUG)
+strvec_JoinDebug(vec_t* vec, const char* separator, const char* filename, int lineNumber) {
+	return str_JoinDebug(separator, (const string* const*) vec_Elements(vec), vec_Count(vec), filename, lineNumber);
+#else
+strvec_Join(vec_t* vec, const char* separator) {
+	return str_Join(separator, (const string* const*) vec_Elements(vec), vec_Count(vec));
+#endif
+}
@@ -29,6 +29,13 @@
 extern set_t*
 strset_Create(void);
 
+extern set_t*
+strset_CreateArena(mem_arena_t* arena);
+
+/* Create a set of interned strings, see str_Intern. Elements are compared and hashed by address. */
+extern set_t*
+strset_CreateInterned(void);
+
 INLINE bool
 strset_Exists(set_t* set, const string* element) {
 	return set_Exists(set, (intptr_t) element);
@@ -56,6 +63,9 @@ strvec_CreateDebug(const char* filename, int lineNumber);
 strvec_Create(void);
 #endif
 
+extern vec_t*
+strvec_CreateArena(mem_arena_t* arena);
+
 extern vec_t*
 strvec_Copy(vec_t* collection);
 
@@ -74,6 +84,15 @@ strvec_SetAt(vec_t* vec, size_t index, const string* element) {
 	vec_SetAt(vec, index, (intptr_t) _str_Ref(element));
 }
 
+/* Join the strings in a vector with a zero terminated separator between them, see str_Join */
+extern string*
+#if defined(_DEBUG)
+strvec_JoinDebug(vec_t* vec, const char* separator, const char* filename, int lineNumber);
+#define strvec_Join(vec, separator) strvec_JoinDebug(vec, separator, __FILE__, __LINE__)
+#else
+strvec_Join(vec_t* vec, const char* separator);
+#endif
+
 #define strvec_Freeze   vec_Freeze
 #define strvec_Frozen   vec_Frozen
 #define strvec_Free     vec_Free
@@ -92,6 +111,18 @@ strmap_CreateDebug(free_t valueFree, const char* filename, int lineNumber);
 strmap_Create(free_t valueFree);
 #endif
 
+extern strmap_t*
+strmap_CreateArena(mem_arena_t* arena, free_t valueFree);
+
+/* Create a map keyed by interned strings, see str_Intern. Keys are compared and hashed by address. */
+extern strmap_t*
+#if defined(_DEBUG)
+strmap_CreateInternedDebug(free_t valueFree, const char* filename, int lineNumber);
+#define strmap_CreateInterned(valueFree) strmap_CreateInternedDebug(valueFree, __FILE__, __LINE__)
+#else
+strmap_CreateInterned(free_t valueFree);
+#endif
+
 INLINE strmap_t*
 strmap_CreateSubMap(strmap_t* map) {
 	return map_CreateSubMap(map);
@@ -0,0 +1,290 @@
+/*  Copyright 2008-2026 Carsten Elton Sorensen
+
+    This file is part of ASMotor.
+
+    ASMotor is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ASMotor is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ASMotor.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Length based searching. The forward kernels use SSE2, or AVX2 when the processor supports it, which is detected
+ * on first use. Substrings are found by comparing the first and last byte of the needle at every position of a
+ * block at once, and only comparing the rest of the needle where both match. */
+
+#include <string.h>
+
+#include "str.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || (defined(__i386__) && defined(__SSE2__))
+#define SIMD_SSE2
+#include <emmintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define SIMD_AVX2
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#elif defined(_MSC_VER)
+#define SIMD_AVX2
+#define TARGET_AVX2
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(SIMD_SSE2)
+INLINE uint32_t
+lowestBit(uint32_t mask) {
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return (uint32_t) index;
+#else
+	return (uint32_t) __builtin_ctz(mask);
+#endif
+}
+
+INLINE uint32_t
+highestBit(uint32_t mask) {
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanReverse(&index, mask);
+	return (uint32_t) index;
+#else
+	return 31U - (uint32_t) __builtin_clz(mask);
+#endif
+}
+#endif
+
+// Scalar kernels, used for the tails of the vector kernels and on other processors
+
+static const char*
+findByteScalar(const char* data, size_t length, char ch) {
+	return memchr(data, ch, length);
+}
+
+static const char*
+findBytesScalar(const char* data, size_t length, const char* needle, size_t needleLength) {
+	if (needleLength > length)
+		return NULL;
+
+	const char* last = data + length - needleLength;
+	for (const char* p = data; p <= last; ++p) {
+		p = memchr(p, needle[0], (size_t) (last - p) + 1);
+		if (p == NULL)
+			return NULL;
+		if (memcmp(p + 1, needle + 1, needleLength - 1) == 0)
+			return p;
+	}
+	return NULL;
+}
+
+#if defined(SIMD_SSE2)
+static const char*
+findByteSse2(const char* data, size_t length, char ch) {
+	__m128i pattern = _mm_set1_epi8(ch);
+	size_t i = 0;
+	for (; i + 16 <= length; i += 16) {
+		__m128i block = _mm_loadu_si128((const __m128i*) (data + i));
+		uint32_t mask = (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(block, pattern));
+		if (mask != 0)
+			return data + i + lowestBit(mask);
+	}
+	return findByteScalar(data + i, length - i, ch);
+}
+
+static const char*
+findBytesSse2(const char* data, size_t length, const char* needle, size_t needleLength) {
+	if (needleLength > length)
+		return NULL;
+
+	__m128i first = _mm_set1_epi8(needle[0]);
+	__m128i last = _mm_set1_epi8(needle[needleLength - 1]);
+	size_t positions = length - needleLength + 1;
+	size_t i = 0;
+	for (; i + 16 <= positions; i += 16) {
+		__m128i blockFirst = _mm_loadu_si128((const __m128i*) (data + i));
+		__m128i blockLast = _mm_loadu_si128((const __m128i*) (data + i + needleLength - 1));
+		__m128i matches = _mm_and_si128(_mm_cmpeq_epi8(blockFirst, first), _mm_cmpeq_epi8(blockLast, last));
+		uint32_t mask = (uint32_t) _mm_movemask_epi8(matches);
+		while (mask != 0) {
+			uint32_t bit = lowestBit(mask);
+			if (memcmp(data + i + bit + 1, needle + 1, needleLength - 2) == 0)
+				return data + i + bit;
+			mask &= mask - 1;
+		}
+	}
+	return findBytesScalar(data + i, length - i, needle, needleLength);
+}
+#endif
+
+#if defined(SIMD_AVX2)
+TARGET_AVX2 static const char*
+findByteAvx2(const char* data, size_t length, char ch) {
+	__m256i pattern = _mm256_set1_epi8(ch);
+	size_t i = 0;
+	for (; i + 32 <= length; i += 32) {
+		__m256i block = _mm256_loadu_si256((const __m256i*) (data + i));
+		uint32_t mask = (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, pattern));
+		if (mask != 0)
+			return data + i + lowestBit(mask);
+	}
+	return findByteSse2(data + i, length - i, ch);
+}
+
+TARGET_AVX2 static const char*
+findBytesAvx2(const char* data, size_t length, const char* needle, size_t needleLength) {
+	if (needleLength > length)
+		return NULL;
+
+	__m256i first = _mm256_set1_epi8(needle[0]);
+	__m256i last = _mm256_set1_epi8(needle[needleLength - 1]);
+	size_t positions = length - needleLength + 1;
+	size_t i = 0;
+	for (; i + 32 <= positions; i += 32) {
+		__m256i blockFirst = _mm256_loadu_si256((const __m256i*) (data + i));
+		__m256i blockLast = _mm256_loadu_si256((const __m256i*) (data + i + needleLength - 1));
+		__m256i matches = _mm256_and_si256(_mm256_cmpeq_epi8(blockFirst, first), _mm256_cmpeq_epi8(blockLast, last));
+		uint32_t mask = (uint32_t) _mm256_movemask_epi8(matches);
+		while (mask != 0) {
+			uint32_t bit = lowestBit(mask);
+			if (memcmp(data + i + bit + 1, needle + 1, needleLength - 2) == 0)
+				return data + i + bit;
+			mask &= mask - 1;
+		}
+	}
+	return findBytesSse2(data + i, length - i, needle, needleLength);
+}
+
+static bool
+hasAvx2(void) {
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return false;
+	__cpuid(info, 1);
+	// AVX2 needs the operating system to save the YMM registers
+	if ((info[2] & (1 << 27)) == 0 || (_xgetbv(0) & 6) != 6)
+		return false;
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+// Kernels are selected the first time they are used
+
+static const char*
+resolveFindByte(const char* data, size_t length, char ch);
+
+static const char*
+resolveFindBytes(const char* data, size_t length, const char* needle, size_t needleLength);
+
+static const char* (*g_findByte)(const char*, size_t, char) = resolveFindByte;
+static const char* (*g_findBytes)(const char*, size_t, const char*, size_t) = resolveFindBytes;
+
+static void
+selectKernels(void) {
+#if defined(SIMD_AVX2)
+	if (hasAvx2()) {
+		g_findByte = findByteAvx2;
+		g_findBytes = findBytesAvx2;
+		return;
+	}
+#endif
+#if defined(SIMD_SSE2)
+	g_findByte = findByteSse2;
+	g_findBytes = findBytesSse2;
+#else
+	g_findByte = findByteScalar;
+	g_findBytes = findBytesScalar;
+#endif
+}
+
+static const char*
+resolveFindByte(const char* data, size_t length, char ch) {
+	selectKernels();
+	return g_findByte(data, length, ch);
+}
+
+static const char*
+resolveFindBytes(const char* data, size_t length, const char* needle, size_t needleLength) {
+	selectKernels();
+	return g_findBytes(data, length, needle, needleLength);
+}
+
+const char*
+str_FindByte(const char* data, size_t length, char ch) {
+	return g_findByte(data, length, ch);
+}
+
+const char*
+str_FindBytes(const char* data, size_t length, const char* needle, size_t needleLength) {
+	if (needleLength <= 1)
+		return needleLength == 0 ? data : g_findByte(data, length, needle[0]);
+	return g_findBytes(data, length, needle, needleLength);
+}
+
+const char*
+str_FindLastByte(const char* data, size_t length, char ch) {
+	size_t i = length;
+#if defined(SIMD_SSE2)
+	__m128i pattern = _mm_set1_epi8(ch);
+	for (; i >= 16; i -= 16) {
+		__m128i block = _mm_loadu_si128((const __m128i*) (data + i - 16));
+		uint32_t mask = (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(block, pattern));
+		if (mask != 0)
+			return data + i - 16 + highestBit(mask);
+	}
+#endif
+	while (i > 0) {
+		if (data[--i] == ch)
+			return data + i;
+	}
+	return NULL;
+}
+
+const char*
+str_FindLastBytes(const char* data, size_t length, const char* needle, size_t needleLength) {
+	if (needleLength <= 1)
+		return needleLength == 0 ? data + length : str_FindLastByte(data, length, needle[0]);
+	if (needleLength > length)
+		return NULL;
+
+	// Positions are scanned from the end, i is one past the last position still to be scanned
+	size_t i = length - needleLength + 1;
+#if defined(SIMD_SSE2)
+	__m128i first = _mm_set1_epi8(needle[0]);
+	__m128i last = _mm_set1_epi8(needle[needleLength - 1]);
+	for (; i >= 16; i -= 16) {
+		const char* block = data + i - 16;
+		__m128i blockFirst = _mm_loadu_si128((const __m128i*) block);
+		__m128i blockLast = _mm_loadu_si128((const __m128i*) (block + needleLength - 1));
+		__m128i matches = _mm_and_si128(_mm_cmpeq_epi8(blockFirst, first), _mm_cmpeq_epi8(blockLast, last));
+		uint32_t mask = (uint32_t) _mm_movemask_epi8(matches);
+		while (mask != 0) {
+			uint32_t bit = highestBit(mask);
+			if (memcmp(block + bit + 1, needle + 1, needleLength - 2) == 0)
+				return block + bit;
+			mask &= ~(1U << bit);
+		}
+	}
+#endif
+	while (i > 0) {
+		--i;
+		if (data[i] == needle[0] && memcmp(data + i + 1, needle + 1, needleLength - 1) == 0)
+			return data + i;
+	}
+	return NULL;
+}
@@ -0,0 +1,367 @@
+/*  Copyright 2008-2026 Carsten Elton Sorensen
+
+    This file is part of ASMotor.
+
+    ASMotor is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ASMotor is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ASMotor.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* String formatting. The integer, character and string conversions are handled here, with the flags, widths and
+ * precisions printf allows for them. Formats using any other conversion are passed on to vsnprintf. */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "str.h"
+
+static const char g_digitPairs[201] = "00010203040506070809"
+                                      "10111213141516171819"
+                                      "20212223242526272829"
+                                      "30313233343536373839"
+                                      "40414243444546474849"
+                                      "50515253545556575859"
+                                      "60616263646566676869"
+                                      "70717273747576777879"
+                                      "80818283848586878889"
+                                      "90919293949596979899";
+
+static const char g_upperHexDigits[16] = "0123456789ABCDEF";
+static const char g_lowerHexDigits[16] = "0123456789abcdef";
+
+// Write the digits of a number backwards from end, two at a time, and return the first digit
+static char*
+unsignedDigits(char* end, uint64_t value) {
+	while (value >= 100) {
+		const char* pair = &g_digitPairs[(value % 100) * 2];
+		value /= 100;
+		*--end = pair[1];
+		*--end = pair[0];
+	}
+	if (value >= 10) {
+		*--end = g_digitPairs[value * 2 + 1];
+		*--end = g_digitPairs[value * 2];
+	} else {
+		*--end = (char) ('0' + value);
+	}
+	return end;
+}
+
+static char*
+hexDigits(char* end, uint64_t value, const char* digits) {
+	do {
+		*--end = digits[value & 0xF];
+		value >>= 4U;
+	} while (value != 0);
+	return end;
+}
+
+size_t
+str_FormatUnsigned(char* dest, uint64_t value) {
+	char digits[STR_MAX_NUMBER_DIGITS];
+	char* first = unsignedDigits(digits + sizeof(digits), value);
+	size_t length = (size_t) (digits + sizeof(digits) - first);
+	memcpy(dest, first, length);
+	return length;
+}
+
+size_t
+str_FormatHex(char* dest, uint64_t value, uint32_t minDigits) {
+	char digits[STR_MAX_NUMBER_DIGITS];
+	char* first = hexDigits(digits + sizeof(digits), value, g_upperHexDigits);
+	size_t length = (size_t) (digits + sizeof(digits) - first);
+	size_t padding = minDigits > length ? minDigits - length : 0;
+	memset(dest, '0', padding);
+	memcpy(dest + padding, first, length);
+	return padding + length;
+}
+
+typedef struct {
+	char* data;
+	size_t capacity;
+	size_t length;
+} SFormatOutput;
+
+typedef struct {
+	bool leftAlign;
+	bool zeroPad;
+	char sign;
+	int width;
+	int precision;
+	char size;
+	char conversion;
+} SFormatSpec;
+
+// Output past the capacity is counted but not stored, like vsnprintf
+INLINE void
+putChars(SFormatOutput* output, const char* chars, size_t count) {
+	if (output->length < output->capacity) {
+		size_t room = output->capacity - output->length;
+		memcpy(output->data + output->length, chars, count < room ? count : room);
+	}
+	output->length += count;
+}
+
+INLINE void
+putRepeated(SFormatOutput* output, char ch, size_t count) {
+	if (output->length < output->capacity) {
+		size_t room = output->capacity - output->length;
+		memset(output->data + output->length, ch, count < room ? count : room);
+	}
+	output->length += count;
+}
+
+// Parse a conversion following a '%'. Widths and precisions given as '*' are read from args when it is not NULL.
+// Returns the character following the conversion, or NULL if it is not one handled here.
+static const char*
+parseSpec(const char* format, SFormatSpec* spec, va_list* args) {
+	spec->leftAlign = false;
+	spec->zeroPad = false;
+	spec->sign = 0;
+	spec->width = 0;
+	spec->precision = -1;
+	spec->size = 0;
+
+	for (;; ++format) {
+		if (*format == '-')
+			spec->leftAlign = true;
+		else if (*format == '0')
+			spec->zeroPad = true;
+		else if (*format == '+')
+			spec->sign = '+';
+		else if (*format == ' ')
+			spec->sign = spec->sign != 0 ? spec->sign : ' ';
+		else
+			break;
+	}
+
+	if (*format == '*') {
+		++format;
+		if (args != NULL) {
+			spec->width = va_arg(*args, int);
+			if (spec->width < 0) {
+				spec->leftAlign = true;
+				spec->width = -spec->width;
+			}
+		}
+	} else {
+		while (*format >= '0' && *format <= '9')
+			spec->width = spec->width * 10 + (*format++ - '0');
+	}
+
+	if (*format == '.') {
+		++format;
+		spec->precision = 0;
+		if (*format == '*') {
+			++format;
+			if (args != NULL) {
+				spec->precision = va_arg(*args, int);
+				if (spec->precision < 0)
+					spec->precision = -1;
+			}
+		} else {
+			while (*format >= '0' && *format <= '9')
+				spec->precision = spec->precision * 10 + (*format++ - '0');
+		}
+	}
+
+	// hh and ll are stored as H and L
+	if (*format == 'h' || *format == 'l') {
+		spec->size = *format++;
+		if (*format == spec->size) {
+			spec->size = spec->size == 'h' ? 'H' : 'L';
+			++format;
+		}
+	} else if (*format == 'z' || *format == 'j') {
+		spec->size = *format++;
+	}
+
+	spec->conversion = *format;
+	switch (spec->conversion) {
+		case 'd':
+		case 'i':
+		case 'u':
+		case 'x':
+		case 'X':
+			return format + 1;
+		case 's':
+		case 'c':
+		case '%':
+			return spec->size == 0 ? format + 1 : NULL;
+		default:
+			return NULL;
+	}
+}
+
+static int64_t
+signedArgument(const SFormatSpec* spec, va_list* args) {
+	switch (spec->size) {
+		case 'H':
+			return (signed char) va_arg(*args, int);
+		case 'h':
+			return (short) va_arg(*args, int);
+		case 'l':
+			return va_arg(*args, long);
+		case 'L':
+			return va_arg(*args, long long);
+		case 'z':
+			return va_arg(*args, ssize_t);
+		case 'j':
+			return va_arg(*args, intmax_t);
+		default:
+			return va_arg(*args, int);
+	}
+}
+
+static uint64_t
+unsignedArgument(const SFormatSpec* spec, va_list* args) {
+	switch (spec->size) {
+		case 'H':
+			return (unsigned char) va_arg(*args, unsigned int);
+		case 'h':
+			return (unsigned short) va_arg(*args, unsigned int);
+		case 'l':
+			return va_arg(*args, unsigned long);
+		case 'L':
+			return va_arg(*args, unsigned long long);
+		case 'z':
+			return va_arg(*args, size_t);
+		case 'j':
+			return va_arg(*args, uintmax_t);
+		default:
+			return va_arg(*args, unsigned int);
+	}
+}
+
+// Pad a field of length characters to the width, zero padding goes between the sign and the digits
+static void
+putField(SFormatOutput* output, const SFormatSpec* spec, char sign, const char* digits, size_t digitCount,
+         size_t zeroes) {
+	size_t length = (sign != 0) + zeroes + digitCount;
+	size_t padding = (size_t) spec->width > length ? (size_t) spec->width - length : 0;
+
+	if (padding != 0 && !spec->leftAlign) {
+		if (spec->zeroPad && spec->precision < 0 && spec->conversion != 's' && spec->conversion != 'c') {
+			zeroes += padding;
+		} else {
+			putRepeated(output, ' ', padding);
+		}
+	}
+
+	if (sign != 0)
+		putChars(output, &sign, 1);
+	putRepeated(output, '0', zeroes);
+	putChars(output, digits, digitCount);
+
+	if (padding != 0 && spec->leftAlign)
+		putRepeated(output, ' ', padding);
+}
+
+static void
+putInteger(SFormatOutput* output, const SFormatSpec* spec, va_list* args) {
+	char buffer[STR_MAX_NUMBER_DIGITS];
+	char* end = buffer + sizeof(buffer);
+	char sign = 0;
+	uint64_t value;
+
+	if (spec->conversion == 'd' || spec->conversion == 'i') {
+		int64_t signedValue = signedArgument(spec, args);
+		value = signedValue < 0 ? 0 - (uint64_t) signedValue : (uint64_t) signedValue;
+		sign = signedValue < 0 ? '-' : spec->sign;
+	} else {
+		value = unsignedArgument(spec, args);
+	}
+
+	char* digits = end;
+	if (value != 0 || spec->precision != 0) {
+		if (spec->conversion == 'x')
+			digits = hexDigits(end, value, g_lowerHexDigits);
+		else if (spec->conversion == 'X')
+			digits = hexDigits(end, value, g_upperHexDigits);
+		else
+			digits = unsignedDigits(end, value);
+	}
+
+	size_t digitCount = (size_t) (end - digits);
+	size_t zeroes = spec->precision > 0 && (size_t) spec->precision > digitCount ? spec->precision - digitCount : 0;
+	putField(output, spec, sign, digits, digitCount, zeroes);
+}
+
+static void
+putString(SFormatOutput* output, const SFormatSpec* spec, va_list* args) {
+	const char* str = va_arg(*args, const char*);
+	if (str == NULL)
+		str = "(null)";
+
+	size_t length;
+	if (spec->precision >= 0) {
+		const char* end = memchr(str, 0, (size_t) spec->precision);
+		length = end != NULL ? (size_t) (end - str) : (size_t) spec->precision;
+	} else {
+		length = strlen(str);
+	}
+	putField(output, spec, 0, str, length, 0);
+}
+
+size_t
+str_FormatArgs(char* dest, size_t capacity, const char* format, va_list args) {
+	va_list list;
+	va_copy(list, args);
+
+	SFormatOutput output = {dest, capacity, 0};
+	const char* start = format;
+	const char* literal = format;
+	for (;;) {
+		while (*format != 0 && *format != '%')
+			++format;
+		putChars(&output, literal, (size_t) (format - literal));
+		if (*format == 0)
+			break;
+
+		SFormatSpec spec;
+		format = parseSpec(format + 1, &spec, &list);
+		if (format == NULL)
+			break;
+
+		switch (spec.conversion) {
+			case 's':
+				putString(&output, &spec, &list);
+				break;
+			case 'c': {
+				char ch = (char) va_arg(list, int);
+				putField(&output, &spec, 0, &ch, 1, 0);
+				break;
+			}
+			case '%':
+				putChars(&output, "%", 1);
+				break;
+			default:
+				putInteger(&output, &spec, &list);
+				break;
+		}
+		literal = format;
+	}
+	va_end(list);
+
+	// Formats with conversions not handled here are formatted again from the start by the C library
+	if (format == NULL) {
+		int length = vsnprintf(dest, capacity, start, args);
+		return length > 0 ? (size_t) length : 0;
+	}
+
+	if (capacity != 0)
+		dest[output.length < capacity ? output.length : capacity - 1] = 0;
+
+	return output.length;
+}
@@ -0,0 +1,297 @@
+/*  Copyright 2008-2026 Carsten Elton Sorensen
+
+    This file is part of ASMotor.
+
+    ASMotor is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ASMotor is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ASMotor.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Aho-Corasick matching. The trie of the patterns is turned into a complete state machine, so every character of
+ * the text is a single table lookup. Characters are first mapped to classes, one for each character occurring in
+ * the patterns and one for all other characters, which keeps the table small. */
+
+#include <string.h>
+
+#include "mem.h"
+#include "strmatch.h"
+
+#define NO_STATE   UINT32_MAX
+#define NO_PATTERN UINT32_MAX
+
+typedef struct {
+	uint32_t pattern; // The pattern ending in this state, or NO_PATTERN
+	uint32_t output;  // The nearest state on the fail chain, including this one, that ends a pattern
+	uint32_t fail;    // The state of the longest proper suffix that is also a prefix of a pattern
+	uint32_t depth;
+} SMatchState;
+
+struct StringMatcher {
+	uint16_t classes[256];
+	uint32_t classCount;
+	uint32_t stateCount;
+	uint32_t* next;
+	SMatchState* states;
+	uint32_t* patternLengths;
+	size_t patternCount;
+};
+
+INLINE uint32_t
+nextState(const strmatch_t* matcher, uint32_t state, char ch) {
+	return matcher->next[state * matcher->classCount + matcher->classes[(uint8_t) ch]];
+}
+
+static void
+assignClasses(strmatch_t* matcher, vec_t* patterns, bool ignoreCase) {
+	memset(matcher->classes, 0, sizeof(matcher->classes));
+	matcher->classCount = 1;
+
+	for (size_t i = 0; i < matcher->patternCount; ++i) {
+		const string* pattern = (const string*) vec_ElementAt(patterns, i);
+		for (size_t j = 0; j < str_Length(pattern); ++j) {
+			uint8_t ch = (uint8_t) (ignoreCase ? str_CharToLower(str_String(pattern)[j]) : str_String(pattern)[j]);
+			if (matcher->classes[ch] == 0)
+				matcher->classes[ch] = (uint16_t) matcher->classCount++;
+		}
+	}
+
+	// The patterns were folded to lower case, upper case letters share the class of their lower case letter
+	if (ignoreCase) {
+		for (uint32_t ch = 'A'; ch <= 'Z'; ++ch)
+			matcher->classes[ch] = matcher->classes[ch | 0x20U];
+	}
+}
+
+static void
+buildTrie(strmatch_t* matcher, vec_t* patterns) {
+	SMatchState* root = &matcher->states[0];
+	root->pattern = NO_PATTERN;
+	root->depth = 0;
+	matcher->stateCount = 1;
+
+	for (size_t i = 0; i < matcher->patternCount; ++i) {
+		const string* pattern = (const string*) vec_ElementAt(patterns, i);
+		matcher->patternLengths[i] = (uint32_t) str_Length(pattern);
+
+		uint32_t state = 0;
+		for (size_t j = 0; j < str_Length(pattern); ++j) {
+			uint32_t* next = &matcher->next[state * matcher->classCount + matcher->classes[(uint8_t) str_String(pattern)[j]]];
+			if (*next == NO_STATE) {
+				SMatchState* added = &matcher->states[matcher->stateCount];
+				added->pattern = NO_PATTERN;
+				added->depth = matcher->states[state].depth + 1;
+				*next = matcher->stateCount++;
+			}
+			state = *next;
+		}
+
+		if (state != 0 && matcher->states[state].pattern == NO_PATTERN)
+			matcher->states[state].pattern = (uint32_t) i;
+	}
+}
+
+// Fill in the fail and output links breadth first, and turn the missing trie edges into the transitions of the
+// fail state, which is shallower and so already complete
+static void
+linkStates(strmatch_t* matcher) {
+	uint32_t* queue = mem_Alloc(matcher->stateCount * sizeof(uint32_t));
+	uint32_t head = 0;
+	uint32_t tail = 0;
+
+	SMatchState* root = &matcher->states[0];
+	root->fail = 0;
+	root->output = NO_STATE;
+	for (uint32_t c = 0; c < matcher->classCount; ++c) {
+		uint32_t* next = &matcher->next[c];
+		if (*next == NO_STATE) {
+			*next = 0;
+		} else {
+			SMatchState* child = &matcher->states[*next];
+			child->fail = 0;
+			child->output = child->pattern != NO_PATTERN ? *next : NO_STATE;
+			queue[tail++] = *next;
+		}
+	}
+
+	while (head < tail) {
+		uint32_t state = queue[head++];
+		uint32_t* next = &matcher->next[state * matcher->classCount];
+		const uint32_t* failNext = &matcher->next[matcher->states[state].fail * matcher->classCount];
+		for (uint32_t c = 0; c < matcher->classCount; ++c) {
+			if (next[c] == NO_STATE) {
+				next[c] = failNext[c];
+			} else {
+				SMatchState* child = &matcher->states[next[c]];
+				child->fail = failNext[c];
+				child->output = child->pattern != NO_PATTERN ? next[c] : matcher->states[child->fail].output;
+				queue[tail++] = next[c];
+			}
+		}
+	}
+
+	mem_Free(queue);
+}
+
+static strmatch_t*
+#if defined(_DEBUG)
+createMatcher(vec_t* patterns, bool ignoreCase, const char* filename, int lineNumber) {
+	strmatch_t* matcher = mem_AllocImpl(sizeof(strmatch_t), filename, lineNumber);
+#else
+createMatcher(vec_t* patterns, bool ignoreCase) {
+	strmatch_t* matcher = mem_Alloc(sizeof(strmatch_t));
+#endif
+	matcher->patternCount = vec_Count(patterns);
+	assignClasses(matcher, patterns, ignoreCase);
+
+	// The trie has at most one state for each character of the patterns, and the root
+	size_t maxStates = 1;
+	for (size_t i = 0; i < matcher->patternCount; ++i)
+		maxStates += str_Length((const string*) vec_ElementAt(patterns, i));
+
+	matcher->next = mem_Alloc(maxStates * matcher->classCount * sizeof(uint32_t));
+	memset(matcher->next, 0xFF, maxStates * matcher->classCount * sizeof(uint32_t));
+	matcher->states = mem_Alloc(maxStates * sizeof(SMatchState));
+	matcher->patternLengths = mem_Alloc((matcher->patternCount + 1) * sizeof(uint32_t));
+
+	buildTrie(matcher, patterns);
+	linkStates(matcher);
+
+	if (matcher->stateCount < maxStates) {
+		matcher->next = mem_Realloc(matcher->next, matcher->stateCount * matcher->classCount * sizeof(uint32_t));
+		matcher->states = mem_Realloc(matcher->states, matcher->stateCount * sizeof(SMatchState));
+	}
+
+	return matcher;
+}
+
+strmatch_t*
+#if defined(_DEBUG)
+strmatch_CreateDebug(vec_t* patterns, const char* filename, int lineNumber) {
+	return createMatcher(patterns, false, filename, lineNumber);
+#else
+strmatch_Create(vec_t* patterns) {
+	return createMatcher(patterns, false);
+#endif
+}
+
+strmatch_t*
+#if defined(_DEBUG)
+strmatch_CreateIDebug(vec_t* patterns, const char* filename, int lineNumber) {
+	return createMatcher(patterns, true, filename, lineNumber);
+#else
+strmatch_CreateI(vec_t* patterns) {
+	return createMatcher(patterns, true);
+#endif
+}
+
+void
+strmatch_Free(strmatch_t* matcher) {
+	if (matcher == NULL)
+		return;
+
+	mem_Free(matcher->patternLengths);
+	mem_Free(matcher->states);
+	mem_Free(matcher->next);
+	mem_Free(matcher);
+}
+
+bool
+strmatch_Find(const strmatch_t* matcher, const char* data, size_t length, size_t start, strmatch_match_t* match) {
+	bool found = false;
+	uint32_t state = 0;
+	for (size_t i = start; i < length; ++i) {
+		state = nextState(matcher, state, data[i]);
+		size_t end = i + 1;
+
+		// Any match still to be found starts after the current state's prefix does, so none can be better
+		if (found && end - matcher->states[state].depth > match->offset)
+			return true;
+
+		// The longest pattern ending here is the one starting earliest
+		uint32_t output = matcher->states[state].output;
+		if (output != NO_STATE) {
+			uint32_t pattern = matcher->states[output].pattern;
+			size_t offset = end - matcher->patternLengths[pattern];
+			if (!found || offset <= match->offset) {
+				match->offset = offset;
+				match->length = matcher->patternLengths[pattern];
+				match->pattern = pattern;
+				found = true;
+			}
+		}
+	}
+	return found;
+}
+
+size_t
+strmatch_ForEach(const strmatch_t* matcher, const char* data, size_t length, strmatch_foreach_t forEach,
+                 intptr_t userData) {
+	size_t count = 0;
+	uint32_t state = 0;
+	for (size_t i = 0; i < length; ++i) {
+		state = nextState(matcher, state, data[i]);
+		for (uint32_t output = matcher->states[state].output; output != NO_STATE;
+		     output = matcher->states[matcher->states[output].fail].output) {
+			uint32_t pattern = matcher->states[output].pattern;
+			strmatch_match_t match = {i + 1 - matcher->patternLengths[pattern], matcher->patternLengths[pattern], pattern};
+			++count;
+			if (!forEach(&match, userData))
+				return count;
+		}
+	}
+	return count;
+}
+
+static void
+replaceFrom(const strmatch_t* matcher, string_buffer* buffer, const char* data, size_t length, size_t start,
+            strmatch_match_t* match, vec_t* replacements) {
+	do {
+		strbuf_AppendChars(buffer, data + start, match->offset - start);
+		strbuf_AppendString(buffer, (const string*) vec_ElementAt(replacements, match->pattern));
+		start = match->offset + match->length;
+	} while (strmatch_Find(matcher, data, length, start, match));
+
+	strbuf_AppendChars(buffer, data + start, length - start);
+}
+
+void
+strmatch_ReplaceInto(const strmatch_t* matcher, string_buffer* buffer, const char* data, size_t length,
+                     vec_t* replacements) {
+	strmatch_match_t match;
+	if (strmatch_Find(matcher, data, length, 0, &match))
+		replaceFrom(matcher, buffer, data, length, 0, &match, replacements);
+	else
+		strbuf_AppendChars(buffer, data, length);
+}
+
+string*
+#if defined(_DEBUG)
+strmatch_ReplaceDebug(const strmatch_t* matcher, const string* str, vec_t* replacements, const char* filename,
+                      int lineNumber) {
+#else
+strmatch_Replace(const strmatch_t* matcher, const string* str, vec_t* replacements) {
+#endif
+	strmatch_match_t match;
+	if (!strmatch_Find(matcher, str_String(str), str_Length(str), 0, &match))
+		return _str_Ref(str);
+
+	string_buffer* buffer = strbuf_Create();
+	replaceFrom(matcher, buffer, str_String(str), str_Length(str), 0, &match, replacements);
+
+#if defined(_DEBUG)
+	string* result = strbuf_StringDebug(buffer, filename, lineNumber);
+#else
+	string* result = strbuf_String(buffer);
+#endif
+	strbuf_Free(buffer);
+	return result;
+}
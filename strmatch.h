@@ -0,0 +1,96 @@
+/*  Copyright 2008-2026 Carsten Elton Sorensen
+
+    This file is part of ASMotor.
+
+    ASMotor is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ASMotor is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ASMotor.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "str.h"
+#include "strbuf.h"
+#include "util.h"
+#include "vec.h"
+
+/*
+ * MULTIPLE PATTERN MATCHING
+ *
+ * A matcher is built once from a vector of strings and then finds all of them in a single pass over a text, in time
+ * proportional to the length of the text. Patterns are identified by their index in the vector. Empty patterns never
+ * match, and of several equal patterns only the first is reported.
+ *
+ * strmatch_Find and the replacing functions find matches that do not overlap, scanning from the start of the text.
+ * Of the matches starting earliest the longest is used, so with the patterns "\1" and "\10" the text "\10" is a
+ * single match of "\10".
+ */
+
+struct StringMatcher;
+typedef struct StringMatcher strmatch_t;
+
+typedef struct {
+	size_t offset;
+	size_t length;
+	size_t pattern;
+} strmatch_match_t;
+
+/* Called for every match, returns false to stop the search */
+typedef bool (*strmatch_foreach_t)(const strmatch_match_t* match, intptr_t userData);
+
+extern strmatch_t*
+#if defined(_DEBUG)
+strmatch_CreateDebug(vec_t* patterns, const char* filename, int lineNumber);
+#define strmatch_Create(patterns) strmatch_CreateDebug(patterns, __FILE__, __LINE__)
+#else
+strmatch_Create(vec_t* patterns);
+#endif
+
+/* Create a matcher that ignores the case of ASCII letters */
+extern strmatch_t*
+#if defined(_DEBUG)
+strmatch_CreateIDebug(vec_t* patterns, const char* filename, int lineNumber);
+#define strmatch_CreateI(patterns) strmatch_CreateIDebug(patterns, __FILE__, __LINE__)
+#else
+strmatch_CreateI(vec_t* patterns);
+#endif
+
+extern void
+strmatch_Free(strmatch_t* matcher);
+
+/* Find the first match at or after start, see above */
+extern bool
+strmatch_Find(const strmatch_t* matcher, const char* data, size_t length, size_t start, strmatch_match_t* match);
+
+/* Report every match, including overlapping ones, in the order they end. Returns the number of matches reported. */
+extern size_t
+strmatch_ForEach(const strmatch_t* matcher, const char* data, size_t length, strmatch_foreach_t forEach,
+                 intptr_t userData);
+
+/* Append the text to a buffer with every match replaced by the string at the index of its pattern in replacements */
+extern void
+strmatch_ReplaceInto(const strmatch_t* matcher, string_buffer* buffer, const char* data, size_t length,
+                     vec_t* replacements);
+
+/* Replace the matches in a string, see strmatch_ReplaceInto. A string without matches is returned as is. */
+extern string*
+#if defined(_DEBUG)
+strmatch_ReplaceDebug(const strmatch_t* matcher, const string* str, vec_t* replacements, const char* filename,
+                      int lineNumber);
+#define strmatch_Replace(matcher, str, replacements) strmatch_ReplaceDebug(matcher, str, replacements, __FILE__, __LINE__)
+#else
+strmatch_Replace(const strmatch_t* matcher, const string* str, vec_t* replacements);
+#endif
@@ -42,13 +42,13 @@ equalsi(intptr_t userData, intptr_t element1, intptr_t element2) {
 static uint32_t
 hash(intptr_t userData, intptr_t element) {
 	const char* str = (const char*) element;
-	return str_JenkinsHashLength(str, strlen(str));
+	return str_HashLength(str, strlen(str));
 }
 
 static uint32_t
 hashi(intptr_t userData, intptr_t element) {
 	const char* str = (const char*) element;
-	return str_JenkinsHashLength(str, strlen(str));
+	return str_HashLengthI(str, strlen(str));
 }
 
 static void
@@ -0,0 +1,132 @@
+/*  Copyright 2008-2026 Carsten Elton Sorensen
+
+    This file is part of ASMotor.
+
+    ASMotor is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ASMotor is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ASMotor.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <assert.h>
+#include <string.h>
+
+#include "strview.h"
+
+static string_view
+createView(string* parent, const char* data, size_t available, ssize_t index, ssize_t length) {
+	if (index < 0)
+		index = (ssize_t) available + index;
+
+	string_view view;
+	view.parent = _str_Ref(parent);
+	if (index < 0 || index >= (ssize_t) available || length <= 0) {
+		view.data = data + available;
+		view.length = 0;
+	} else {
+		view.data = data + index;
+		view.length = (size_t) length > available - index ? available - index : (size_t) length;
+	}
+	return view;
+}
+
+string_view
+strview_Create(const string* parent, ssize_t index, ssize_t length) {
+	assert(parent != NULL);
+	return createView((string*) parent, str_String(parent), str_Length(parent), index, length);
+}
+
+string_view
+strview_Slice(const string_view* view, ssize_t index, ssize_t length) {
+	return createView(view->parent, view->data, view->length, index, length);
+}
+
+string*
+#if defined(_DEBUG)
+strview_StringDebug(const string_view* view, const char* filename, int lineNumber) {
+#else
+strview_String(const string_view* view) {
+#endif
+	if (view->data == str_String(view->parent) && view->length == str_Length(view->parent))
+		return _str_Ref(view->parent);
+
+#if defined(_DEBUG)
+	return str_CreateLengthDebug(view->data, view->length, filename, lineNumber);
+#else
+	return str_CreateLength(view->data, view->length);
+#endif
+}
+
+string*
+#if defined(_DEBUG)
+strview_ConcatDebug(const string_view* view1, const string_view* view2, const char* filename, int lineNumber) {
+	string* result = str_CreateLengthDebug(NULL, view1->length + view2->length, filename, lineNumber);
+#else
+strview_Concat(const string_view* view1, const string_view* view2) {
+	string* result = str_CreateLength(NULL, view1->length + view2->length);
+#endif
+	memcpy(result->data, view1->data, view1->length);
+	memcpy(result->data + view1->length, view2->data, view2->length);
+	return result;
+}
+
+uint32_t
+strview_Find(const string_view* haystack, const string_view* needle) {
+	const char* p = str_FindBytes(haystack->data, haystack->length, needle->data, needle->length);
+	return p != NULL ? (uint32_t) (p - haystack->data) : UINT32_MAX;
+}
+
+uint32_t
+strview_FindChar(const string_view* haystack, char needle) {
+	const char* p = str_FindByte(haystack->data, haystack->length, needle);
+	return p != NULL ? (uint32_t) (p - haystack->data) : UINT32_MAX;
+}
+
+bool
+strview_Equal(const string_view* view1, const string_view* view2) {
+	return view1->length == view2->length && memcmp(view1->data, view2->data, view1->length) == 0;
+}
+
+bool
+strview_EqualString(const string_view* view, const string* str) {
+	return str != NULL && view->length == str_Length(str) && memcmp(view->data, str_String(str), view->length) == 0;
+}
+
+bool
+strview_EqualConst(const string_view* view, const char* str) {
+	return str != NULL && strlen(str) == view->length && memcmp(view->data, str, view->length) == 0;
+}
+
+bool
+strview_NextLine(string_view* text, string_view* line) {
+	if (text->length == 0)
+		return false;
+
+	const char* end = text->data + text->length;
+	const char* lineEnd = text->data;
+	while (lineEnd < end && *lineEnd != '\n' && *lineEnd != '\r')
+		++lineEnd;
+
+	const char* next = lineEnd;
+	if (next < end) {
+		char ch = *next++;
+		if (next < end && (*next == '\n' || *next == '\r') && *next != ch)
+			++next;
+	}
+
+	line->parent = _str_Ref(text->parent);
+	line->data = text->data;
+	line->length = (size_t) (lineEnd - text->data);
+
+	text->length -= (size_t) (next - text->data);
+	text->data = next;
+	return true;
+}
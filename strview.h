@@ -0,0 +1,131 @@
+/*  Copyright 2008-2026 Carsten Elton Sorensen
+
+    This file is part of ASMotor.
+
+    ASMotor is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ASMotor is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ASMotor.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "str.h"
+#include "util.h"
+
+/*
+ * STRING VIEWS
+ *
+ * A string_view is a read-only window into a parent string's characters. Creating a view takes a reference to
+ * the parent, which keeps it alive, and strview_Free releases it again. Views are small values and are passed
+ * around by pointer. Unlike strings, a view's characters are not zero terminated.
+ */
+
+typedef struct {
+	string* parent;
+	const char* data;
+	size_t length;
+} string_view;
+
+/* Create a view of length characters starting at index in a string. A negative index counts from the end, and the
+ * view is clipped to the string. */
+extern string_view
+strview_Create(const string* parent, ssize_t index, ssize_t length);
+
+INLINE string_view
+strview_Whole(const string* parent) {
+	return strview_Create(parent, 0, str_Length(parent));
+}
+
+/* Create a view of part of another view, sharing its parent */
+extern string_view
+strview_Slice(const string_view* view, ssize_t index, ssize_t length);
+
+INLINE string_view
+strview_Copy(const string_view* view) {
+	return strview_Slice(view, 0, view->length);
+}
+
+INLINE void
+strview_Free(string_view* view) {
+	str_Free(view->parent);
+	view->parent = NULL;
+	view->data = NULL;
+	view->length = 0;
+}
+
+INLINE size_t
+strview_Length(const string_view* view) {
+	return view->length;
+}
+
+INLINE const char*
+strview_Data(const string_view* view) {
+	return view->data;
+}
+
+INLINE char
+strview_CharAt(const string_view* view, ssize_t index) {
+	if (index < 0)
+		index = view->length + index;
+	return view->data[index];
+}
+
+/* Create a string holding a view's characters. A view of a whole string returns a new reference to it. */
+extern string*
+#if defined(_DEBUG)
+strview_StringDebug(const string_view* view, const char* filename, int lineNumber);
+#define strview_String(view) strview_StringDebug(view, __FILE__, __LINE__)
+#else
+strview_String(const string_view* view);
+#endif
+
+extern string*
+#if defined(_DEBUG)
+strview_ConcatDebug(const string_view* view1, const string_view* view2, const char* filename, int lineNumber);
+#define strview_Concat(view1, view2) strview_ConcatDebug(view1, view2, __FILE__, __LINE__)
+#else
+strview_Concat(const string_view* view1, const string_view* view2);
+#endif
+
+extern uint32_t
+strview_Find(const string_view* haystack, const string_view* needle);
+
+extern uint32_t
+strview_FindChar(const string_view* haystack, char needle);
+
+extern bool
+strview_Equal(const string_view* view1, const string_view* view2);
+
+extern bool
+strview_EqualString(const string_view* view, const string* str);
+
+extern bool
+strview_EqualConst(const string_view* view, const char* str);
+
+/* The hash of a view's characters, the same as str_Hash of a string with those characters */
+INLINE uint32_t
+strview_Hash(const string_view* view) {
+	return str_HashLength(view->data, view->length);
+}
+
+INLINE string*
+strview_Intern(const string_view* view) {
+	return str_InternLength(view->data, view->length);
+}
+
+/* Split the next line off a view of text. The line is returned without its line ending in a new view sharing the
+ * text's parent, and text is advanced past it. Returns false when text is empty. */
+extern bool
+strview_NextLine(string_view* text, string_view* line);
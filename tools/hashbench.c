@@ -0,0 +1,295 @@
+/*  Copyright 2008-2026 Carsten Elton Sorensen
+
+    This file is part of ASMotor.
+
+    ASMotor is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ASMotor is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ASMotor.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Compares the string hashes on a corpus of symbols. The symbols are the identifiers found in the files given on
+ * the command line, for instance assembly sources or symbol files, or a generated list of local labels when no
+ * files are given.
+ *
+ *   hashbench [file ...]
+ *
+ * For each hash the tool reports the number of full 32 bit collisions and the bucket quality of a set (29 buckets)
+ * and of a power of two table with at least one bucket per symbol. Quality is the number of probes needed compared
+ * to a perfectly random hash, so 1.00 is ideal and higher is worse. The case insensitive hashes are measured on the
+ * symbols that are distinct ignoring case. */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "str.h"
+
+#define SET_BUCKETS    29
+#define TIMING_HASHES  20000000U
+#define GENERATED_SETS 4000
+
+typedef uint32_t (*hash_function_t)(const void* str, size_t length);
+
+typedef struct {
+	const char* name;
+	hash_function_t hash;
+	bool ignoreCase;
+} SHash;
+
+typedef struct {
+	const char* data;
+	size_t length;
+} SSymbol;
+
+static SSymbol* g_symbols;
+static size_t g_symbolCount;
+static size_t g_symbolCapacity;
+
+// The Jenkins hash as it was before it was fixed, skipping every other character
+static uint32_t
+brokenJenkinsHash(const void* str, size_t length) {
+	const uint8_t* key = (const uint8_t*) str;
+	uint32_t hash = 0;
+	for (size_t i = 0; i < length; ++i) {
+		hash += key[i++];
+		hash += hash << 10;
+		hash ^= hash >> 6;
+	}
+	hash += hash << 3;
+	hash ^= hash >> 11;
+	hash += hash << 15;
+	return hash;
+}
+
+static const SHash g_hashes[] = {
+	{"jenkins (old)", brokenJenkinsHash, false},
+	{"jenkins", str_JenkinsHashLength, false},
+	{"fast", str_FastHashLength, false},
+	{"jenkins-i", str_JenkinsHashLengthI, true},
+	{"fast-i", str_FastHashLengthI, true},
+};
+
+static void
+fail(const char* message) {
+	fprintf(stderr, "hashbench: %s\n", message);
+	exit(EXIT_FAILURE);
+}
+
+static void
+addSymbol(const char* data, size_t length) {
+	if (g_symbolCount == g_symbolCapacity) {
+		g_symbolCapacity = g_symbolCapacity == 0 ? 4096 : g_symbolCapacity * 2;
+		g_symbols = realloc(g_symbols, g_symbolCapacity * sizeof(SSymbol));
+		if (g_symbols == NULL)
+			fail("out of memory");
+	}
+	g_symbols[g_symbolCount].data = data;
+	g_symbols[g_symbolCount].length = length;
+	++g_symbolCount;
+}
+
+static bool
+isSymbolStart(char ch) {
+	return isalpha((unsigned char) ch) || ch == '_' || ch == '.' || ch == '@' || ch == '$';
+}
+
+static bool
+isSymbolChar(char ch) {
+	return isSymbolStart(ch) || isdigit((unsigned char) ch) || ch == '#';
+}
+
+static void
+readSymbols(const char* filename) {
+	FILE* fileHandle = fopen(filename, "rb");
+	if (fileHandle == NULL)
+		fail("unable to open file");
+
+	fseek(fileHandle, 0, SEEK_END);
+	long length = ftell(fileHandle);
+	fseek(fileHandle, 0, SEEK_SET);
+
+	// The file contents are kept for the lifetime of the tool, the symbols point into them
+	char* text = malloc(length > 0 ? (size_t) length : 1);
+	if (text == NULL || fread(text, 1, (size_t) length, fileHandle) != (size_t) length)
+		fail("unable to read file");
+	fclose(fileHandle);
+
+	const char* end = text + length;
+	for (const char* p = text; p < end;) {
+		if (isSymbolStart(*p)) {
+			const char* start = p;
+			while (p < end && isSymbolChar(*p))
+				++p;
+			addSymbol(start, (size_t) (p - start));
+		} else {
+			++p;
+		}
+	}
+}
+
+// Local labels of the kind that collided with the old hash, "loop1a", "loop1b", ".l0", ".l1" and so on
+static void
+generateSymbols(void) {
+	static const char* const prefixes[] = {"loop", ".l", "skip", "label_", "Done"};
+	static const char* const suffixes[] = {"", "a", "b", "_end", "x"};
+
+	char* text = malloc(GENERATED_SETS * 5 * 5 * 24);
+	if (text == NULL)
+		fail("out of memory");
+
+	char* p = text;
+	for (int n = 0; n < GENERATED_SETS; ++n) {
+		for (int i = 0; i < 5; ++i) {
+			for (int j = 0; j < 5; ++j) {
+				int length = sprintf(p, "%s%d%s", prefixes[i], n, suffixes[j]);
+				addSymbol(p, (size_t) length);
+				p += length + 1;
+			}
+		}
+	}
+}
+
+static int
+compareSymbols(const void* element1, const void* element2) {
+	const SSymbol* symbol1 = (const SSymbol*) element1;
+	const SSymbol* symbol2 = (const SSymbol*) element2;
+	size_t length = symbol1->length < symbol2->length ? symbol1->length : symbol2->length;
+	int result = memcmp(symbol1->data, symbol2->data, length);
+	if (result != 0)
+		return result;
+	return symbol1->length < symbol2->length ? -1 : symbol1->length > symbol2->length;
+}
+
+static int
+compareSymbolsI(const void* element1, const void* element2) {
+	const SSymbol* symbol1 = (const SSymbol*) element1;
+	const SSymbol* symbol2 = (const SSymbol*) element2;
+	size_t length = symbol1->length < symbol2->length ? symbol1->length : symbol2->length;
+	for (size_t i = 0; i < length; ++i) {
+		int result = toupper((unsigned char) symbol1->data[i]) - toupper((unsigned char) symbol2->data[i]);
+		if (result != 0)
+			return result;
+	}
+	return symbol1->length < symbol2->length ? -1 : symbol1->length > symbol2->length;
+}
+
+// Sort and remove duplicates, returning the number of distinct symbols
+static size_t
+distinctSymbols(SSymbol* symbols, size_t count, int (*compare)(const void*, const void*)) {
+	if (count == 0)
+		return 0;
+
+	qsort(symbols, count, sizeof(SSymbol), compare);
+	size_t distinct = 1;
+	for (size_t i = 1; i < count; ++i) {
+		if (compare(&symbols[distinct - 1], &symbols[i]) != 0)
+			symbols[distinct++] = symbols[i];
+	}
+	return distinct;
+}
+
+static int
+compareHashes(const void* element1, const void* element2) {
+	uint32_t hash1 = *(const uint32_t*) element1;
+	uint32_t hash2 = *(const uint32_t*) element2;
+	return hash1 < hash2 ? -1 : hash1 > hash2;
+}
+
+// The expected number of probes for successful lookups compared to a uniformly random hash
+static double
+bucketQuality(const uint32_t* hashes, size_t count, uint32_t buckets, bool powerOfTwo) {
+	uint32_t* counts = calloc(buckets, sizeof(uint32_t));
+	if (counts == NULL)
+		fail("out of memory");
+
+	for (size_t i = 0; i < count; ++i)
+		++counts[powerOfTwo ? hashes[i] & (buckets - 1) : hashes[i] % buckets];
+
+	double probes = 0;
+	for (uint32_t i = 0; i < buckets; ++i)
+		probes += (double) counts[i] * (counts[i] + 1) / 2;
+	free(counts);
+
+	double expected = (double) count / (2.0 * buckets) * ((double) count + 2.0 * buckets - 1);
+	return probes / expected;
+}
+
+static void
+measure(const SHash* hash, const SSymbol* symbols, size_t count) {
+	uint32_t* hashes = malloc((count != 0 ? count : 1) * sizeof(uint32_t));
+	if (hashes == NULL)
+		fail("out of memory");
+
+	for (size_t i = 0; i < count; ++i)
+		hashes[i] = hash->hash(symbols[i].data, symbols[i].length);
+
+	uint32_t tableBuckets = 1;
+	while (tableBuckets < count)
+		tableBuckets *= 2;
+
+	double setQuality = bucketQuality(hashes, count, SET_BUCKETS, false);
+	double tableQuality = bucketQuality(hashes, count, tableBuckets, true);
+
+	size_t collisions = 0;
+	qsort(hashes, count, sizeof(uint32_t), compareHashes);
+	for (size_t i = 1; i < count; ++i) {
+		if (hashes[i] == hashes[i - 1])
+			++collisions;
+	}
+	free(hashes);
+
+	size_t passes = TIMING_HASHES / count + 1;
+	uint32_t sink = 0;
+	clock_t start = clock();
+	for (size_t pass = 0; pass < passes; ++pass) {
+		for (size_t i = 0; i < count; ++i)
+			sink += hash->hash(symbols[i].data, symbols[i].length);
+	}
+	clock_t end = clock();
+	double seconds = (double) (end - start) / CLOCKS_PER_SEC;
+
+	printf("%-14s %10zu %12.3f %12.3f %10.2f ns/hash  (%08X)\n", hash->name, collisions, setQuality, tableQuality,
+	       seconds * 1e9 / ((double) passes * count), sink);
+}
+
+int
+main(int argc, char* argv[]) {
+	for (int i = 1; i < argc; ++i)
+		readSymbols(argv[i]);
+	if (argc == 1)
+		generateSymbols();
+
+	size_t count = distinctSymbols(g_symbols, g_symbolCount, compareSymbols);
+	SSymbol* symbolsI = malloc((count != 0 ? count : 1) * sizeof(SSymbol));
+	if (symbolsI == NULL)
+		fail("out of memory");
+	memcpy(symbolsI, g_symbols, count * sizeof(SSymbol));
+	size_t countI = distinctSymbols(symbolsI, count, compareSymbolsI);
+	if (count == 0)
+		fail("no symbols found");
+
+	printf("%zu distinct symbols, %zu ignoring case\n\n", count, countI);
+	printf("%-14s %10s %12s %12s\n", "hash", "collisions", "set quality", "table qual.");
+	for (size_t i = 0; i < sizeof(g_hashes) / sizeof(g_hashes[0]); ++i) {
+		const SHash* hash = &g_hashes[i];
+		if (hash->ignoreCase)
+			measure(hash, symbolsI, countI);
+		else
+			measure(hash, g_symbols, count);
+	}
+
+	free(symbolsI);
+	free(g_symbols);
+	return EXIT_SUCCESS;
+}
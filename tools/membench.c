@@ -0,0 +1,114 @@
+/*  Copyright 2008-2026 Carsten Elton Sorensen
+
+    This file is part of ASMotor.
+
+    ASMotor is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ASMotor is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ASMotor.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Compares mem_Alloc against the plain C library allocator on a symbol table like workload: lots of small
+ * blocks in a handful of sizes, freed in a different order than they were allocated.
+ *
+ * Build the library and the tool with NDEBUG, for instance with CMAKE_BUILD_TYPE=Release, or the debug allocator
+ * with its leak registry is timed instead. Building with ASMOTOR_NO_SLAB_ALLOC as well gives the baseline of
+ * mem_Alloc passing every block to malloc. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "mem.h"
+
+#define LIVE_BLOCKS 65536U
+#define ITERATIONS  4000000U
+
+static uint32_t g_seed;
+
+static uint32_t
+nextRandom(void) {
+	g_seed = g_seed * 1664525U + 1013904223U;
+	return g_seed >> 8U;
+}
+
+static size_t
+nextSize(void) {
+	static const size_t sizes[] = {16, 16, 16, 24, 24, 32, 40, 48, 64, 96, 160, 320};
+	return sizes[nextRandom() % (sizeof(sizes) / sizeof(sizes[0]))];
+}
+
+static void*
+libcAlloc(size_t size) {
+	return malloc(size);
+}
+
+static void
+libcFree(void* memory) {
+	free(memory);
+}
+
+static void*
+memAlloc(size_t size) {
+	return mem_Alloc(size);
+}
+
+static void
+memFree(void* memory) {
+	mem_Free(memory);
+}
+
+static double
+run(const char* name, void* (*allocate)(size_t), void (*release)(void*)) {
+	void** blocks = calloc(LIVE_BLOCKS, sizeof(void*));
+	g_seed = 12345;
+
+	clock_t start = clock();
+	for (uint32_t i = 0; i < ITERATIONS; ++i) {
+		uint32_t slot = nextRandom() % LIVE_BLOCKS;
+		if (blocks[slot] != NULL)
+			release(blocks[slot]);
+
+		size_t size = nextSize();
+		blocks[slot] = allocate(size);
+		*(uint8_t*) blocks[slot] = (uint8_t) size;
+	}
+	for (uint32_t i = 0; i < LIVE_BLOCKS; ++i) {
+		if (blocks[i] != NULL)
+			release(blocks[i]);
+	}
+	clock_t end = clock();
+
+	free(blocks);
+
+	double seconds = (double) (end - start) / CLOCKS_PER_SEC;
+	printf("%-10s %8.3f s  %8.1f ns/op\n", name, seconds, seconds * 1e9 / ITERATIONS);
+	return seconds;
+}
+
+int
+main(void) {
+#if defined(_DEBUG)
+	fprintf(stderr, "warning: built without NDEBUG, timing the debug allocator. Configure with "
+	                "-DCMAKE_BUILD_TYPE=Release for release timings.\n");
+#endif
+
+	double libc = run("malloc", libcAlloc, libcFree);
+	double mem = run("mem_Alloc", memAlloc, memFree);
+	printf("mem_Alloc/malloc time ratio: %.2f\n", mem / libc);
+#if defined(ASMOTOR_NO_SLAB_ALLOC)
+	printf("Built with ASMOTOR_NO_SLAB_ALLOC, mem_Alloc passes every block to malloc\n");
+#else
+	printf("Build with -DASMOTOR_NO_SLAB_ALLOC for the ratio of mem_Alloc without slabs\n");
+#endif
+
+	return EXIT_SUCCESS;
+}
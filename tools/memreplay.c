@@ -0,0 +1,365 @@
+/*  Copyright 2008-2026 Carsten Elton Sorensen
+
+    This file is part of ASMotor.
+
+    ASMotor is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ASMotor is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ASMotor.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Replays an allocation trace recorded with ASMOTOR_TRACE_MEMORY against one of several allocators, and reports
+ * the time taken and the peak resident set size. The trace format is described in mem.c.
+ *
+ *   memreplay trace-file [malloc|mem|arena]
+ *
+ * The trace is decoded up front, and block addresses are replaced by dense block numbers, so only the allocator
+ * calls themselves are timed. Blocks allocated before the trace was started are left out. Each run replays a
+ * single allocator, as the peak resident set size covers the whole process. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "mem.h"
+
+#define TRACE_MAGIC "ASMTRC01"
+#define NO_BLOCK    UINT32_MAX
+
+typedef struct {
+	char type;
+	uint32_t block;
+	uint32_t oldBlock;
+	size_t size;
+} SEvent;
+
+typedef struct {
+	uintptr_t address;
+	uint32_t block;
+	bool used;
+} SAddressSlot;
+
+static const uint8_t* g_trace;
+static const uint8_t* g_traceEnd;
+
+static SAddressSlot* g_addresses;
+static size_t g_addressCapacity;
+static size_t g_addressCount;
+
+static void
+fail(const char* message) {
+	fprintf(stderr, "memreplay: %s\n", message);
+	exit(EXIT_FAILURE);
+}
+
+static uint64_t
+readNumber(void) {
+	uint64_t value = 0;
+	uint32_t shift = 0;
+	while (g_trace < g_traceEnd && shift < 64) {
+		uint8_t byte = *g_trace++;
+		value |= (uint64_t) (byte & 0x7FU) << shift;
+		if ((byte & 0x80U) == 0)
+			return value;
+		shift += 7;
+	}
+	fail("truncated trace");
+	return 0;
+}
+
+static uintptr_t
+readAddress(uintptr_t* previous) {
+	uint64_t zigzag = readNumber();
+	int64_t delta = (int64_t) (zigzag >> 1U) ^ -(int64_t) (zigzag & 1U);
+	*previous += (uintptr_t) delta;
+	return *previous;
+}
+
+static size_t
+addressHash(uintptr_t address) {
+	return (size_t) (((uint64_t) address * 0x9E3779B97F4A7C15ULL) >> 32U);
+}
+
+static void
+growAddresses(void) {
+	size_t capacity = g_addressCapacity == 0 ? 4096 : g_addressCapacity * 2;
+	SAddressSlot* slots = calloc(capacity, sizeof(SAddressSlot));
+	if (slots == NULL)
+		fail("out of memory");
+
+	for (size_t i = 0; i < g_addressCapacity; ++i) {
+		if (g_addresses[i].used) {
+			size_t index = addressHash(g_addresses[i].address) & (capacity - 1);
+			while (slots[index].used)
+				index = (index + 1) & (capacity - 1);
+			slots[index] = g_addresses[i];
+		}
+	}
+
+	free(g_addresses);
+	g_addresses = slots;
+	g_addressCapacity = capacity;
+}
+
+// Live addresses are removed with backward shift deletion, so lookups never need tombstones
+static SAddressSlot*
+findAddress(uintptr_t address) {
+	size_t index = addressHash(address) & (g_addressCapacity - 1);
+	while (g_addresses[index].used) {
+		if (g_addresses[index].address == address)
+			return &g_addresses[index];
+		index = (index + 1) & (g_addressCapacity - 1);
+	}
+	return &g_addresses[index];
+}
+
+static void
+insertAddress(uintptr_t address, uint32_t block) {
+	if (g_addressCount * 2 >= g_addressCapacity)
+		growAddresses();
+
+	SAddressSlot* slot = findAddress(address);
+	if (!slot->used)
+		++g_addressCount;
+	slot->address = address;
+	slot->block = block;
+	slot->used = true;
+}
+
+static uint32_t
+removeAddress(uintptr_t address) {
+	SAddressSlot* slot = g_addressCapacity != 0 ? findAddress(address) : NULL;
+	if (slot == NULL || !slot->used)
+		return NO_BLOCK;
+
+	uint32_t block = slot->block;
+	size_t hole = (size_t) (slot - g_addresses);
+	size_t index = hole;
+	for (;;) {
+		index = (index + 1) & (g_addressCapacity - 1);
+		if (!g_addresses[index].used)
+			break;
+
+		size_t home = addressHash(g_addresses[index].address) & (g_addressCapacity - 1);
+		if (((index - home) & (g_addressCapacity - 1)) >= ((index - hole) & (g_addressCapacity - 1))) {
+			g_addresses[hole] = g_addresses[index];
+			hole = index;
+		}
+	}
+	g_addresses[hole].used = false;
+	--g_addressCount;
+	return block;
+}
+
+static SEvent*
+decodeTrace(size_t* eventCount, uint32_t* blockCount, size_t* peakLiveBytes) {
+	size_t capacity = 65536;
+	size_t count = 0;
+	SEvent* events = malloc(capacity * sizeof(SEvent));
+	size_t* sizes = NULL;
+	uint32_t blocks = 0;
+	size_t liveBytes = 0;
+	size_t peakBytes = 0;
+	uintptr_t previous = 0;
+
+	while (g_trace < g_traceEnd) {
+		char type = (char) *g_trace++;
+		if (type == 'S') {
+			readNumber();
+			readNumber();
+			uint64_t length = readNumber();
+			if (length > (uint64_t) (g_traceEnd - g_trace))
+				fail("truncated trace");
+			g_trace += length;
+			continue;
+		}
+
+		if (count == capacity) {
+			capacity *= 2;
+			events = realloc(events, capacity * sizeof(SEvent));
+		}
+		if (events == NULL)
+			fail("out of memory");
+
+		SEvent* event = &events[count++];
+		event->type = type;
+		if (type == 'A' || type == 'R') {
+			if (type == 'R') {
+				event->oldBlock = removeAddress(readAddress(&previous));
+				if (event->oldBlock != NO_BLOCK)
+					liveBytes -= sizes[event->oldBlock];
+				else
+					event->type = 'A';
+			}
+			uintptr_t address = readAddress(&previous);
+			event->size = (size_t) readNumber();
+			readNumber();
+
+			if ((blocks & (blocks - 1)) == 0) {
+				sizes = realloc(sizes, (blocks == 0 ? 1 : (size_t) blocks * 2) * sizeof(size_t));
+				if (sizes == NULL)
+					fail("out of memory");
+			}
+			event->block = blocks++;
+			sizes[event->block] = event->size;
+			insertAddress(address, event->block);
+
+			liveBytes += event->size;
+			if (liveBytes > peakBytes)
+				peakBytes = liveBytes;
+		} else if (type == 'F') {
+			event->block = removeAddress(readAddress(&previous));
+			if (event->block == NO_BLOCK) {
+				--count;
+				continue;
+			}
+			liveBytes -= sizes[event->block];
+			event->size = sizes[event->block];
+		} else {
+			fail("unknown record in trace");
+		}
+	}
+
+	free(sizes);
+	*eventCount = count;
+	*blockCount = blocks;
+	*peakLiveBytes = peakBytes;
+	return events;
+}
+
+static size_t
+peakResidentKiB(void) {
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters;
+	GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+	return counters.PeakWorkingSetSize / 1024;
+#else
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+	return (size_t) usage.ru_maxrss / 1024;
+#else
+	return (size_t) usage.ru_maxrss;
+#endif
+#endif
+}
+
+static void
+replay(const char* backend, const SEvent* events, size_t eventCount, uint32_t blockCount) {
+	void** blocks = calloc(blockCount + 1, sizeof(void*));
+	size_t* sizes = calloc(blockCount + 1, sizeof(size_t));
+	if (blocks == NULL || sizes == NULL)
+		fail("out of memory");
+
+	bool useMalloc = strcmp(backend, "malloc") == 0;
+	bool useArena = strcmp(backend, "arena") == 0;
+	if (!useMalloc && !useArena && strcmp(backend, "mem") != 0)
+		fail("unknown allocator, expected malloc, mem or arena");
+
+	mem_arena_t* arena = useArena ? mem_ArenaCreate(MEM_ARENA_DEFAULT_CHUNK_SIZE) : NULL;
+	size_t baseResident = peakResidentKiB();
+
+	clock_t start = clock();
+	for (size_t i = 0; i < eventCount; ++i) {
+		const SEvent* event = &events[i];
+		size_t size = event->size == 0 ? 1 : event->size;
+		switch (event->type) {
+			case 'A':
+				if (useMalloc)
+					blocks[event->block] = malloc(size);
+				else if (useArena)
+					blocks[event->block] = mem_ArenaAlloc(arena, size);
+				else
+					blocks[event->block] = mem_Alloc(size);
+				*(uint8_t*) blocks[event->block] = (uint8_t) size;
+				break;
+			case 'R': {
+				void* memory = blocks[event->oldBlock];
+				if (useMalloc)
+					memory = realloc(memory, size);
+				else if (useArena)
+					memory = mem_ArenaRealloc(arena, memory, sizes[event->oldBlock], size);
+				else
+					memory = mem_Realloc(memory, size);
+				blocks[event->oldBlock] = NULL;
+				blocks[event->block] = memory;
+				*(uint8_t*) memory = (uint8_t) size;
+				break;
+			}
+			case 'F':
+				if (useMalloc)
+					free(blocks[event->block]);
+				else if (!useArena)
+					mem_Free(blocks[event->block]);
+				blocks[event->block] = NULL;
+				break;
+		}
+		sizes[event->block] = size;
+	}
+	clock_t end = clock();
+
+	size_t peakResident = peakResidentKiB();
+	double seconds = (double) (end - start) / CLOCKS_PER_SEC;
+	printf("%-8s %8.3f s  %8.1f ns/event  peak RSS %zu KiB (+%zu KiB during replay)\n", backend, seconds,
+	       eventCount != 0 ? seconds * 1e9 / (double) eventCount : 0.0, peakResident, peakResident - baseResident);
+
+	if (arena != NULL)
+		mem_ArenaFree(arena);
+	free(sizes);
+	free(blocks);
+}
+
+int
+main(int argc, char* argv[]) {
+	if (argc < 2 || argc > 3) {
+		fprintf(stderr, "Usage: memreplay trace-file [malloc|mem|arena]\n");
+		return EXIT_FAILURE;
+	}
+
+	FILE* fileHandle = fopen(argv[1], "rb");
+	if (fileHandle == NULL)
+		fail("unable to open trace");
+
+	fseek(fileHandle, 0, SEEK_END);
+	long length = ftell(fileHandle);
+	fseek(fileHandle, 0, SEEK_SET);
+
+	uint8_t* trace = malloc(length > 0 ? (size_t) length : 1);
+	if (trace == NULL || length < 8 || fread(trace, 1, (size_t) length, fileHandle) != (size_t) length
+	    || memcmp(trace, TRACE_MAGIC, 8) != 0) {
+		fail("not an allocation trace");
+	}
+	fclose(fileHandle);
+
+	g_trace = trace + 8;
+	g_traceEnd = trace + length;
+
+	size_t eventCount;
+	uint32_t blockCount;
+	size_t peakLiveBytes;
+	SEvent* events = decodeTrace(&eventCount, &blockCount, &peakLiveBytes);
+	free(trace);
+	free(g_addresses);
+
+	printf("%zu events, %u blocks, %zu bytes peak live\n", eventCount, blockCount, peakLiveBytes);
+	replay(argc == 3 ? argv[2] : "mem", events, eventCount, blockCount);
+
+	free(events);
+	return EXIT_SUCCESS;
+}
@@ -26,6 +26,8 @@
 
 typedef struct Vector {
 	uint32_t refCount;
+	mem_arena_t* arena;
+	uint32_t alignment;
 	free_t free;
 	intptr_t userData;
 	uint32_t allocatedElements;
@@ -38,8 +40,16 @@ typedef struct Vector {
 static void
 growVector(vec_t* vec) {
 	assert(!vec_Frozen(vec));
+	uint32_t oldElements = vec->allocatedElements;
 	vec->allocatedElements += (vec->allocatedElements >> 1) + 1;
-	vec->elements = mem_Realloc(vec->elements, sizeof(intptr_t) * vec->allocatedElements);
+	if (vec->arena != NULL) {
+		vec->elements = mem_ArenaRealloc(vec->arena, vec->elements, sizeof(intptr_t) * oldElements,
+		                                 sizeof(intptr_t) * vec->allocatedElements);
+	} else if (vec->alignment != 0) {
+		vec->elements = mem_ReallocAligned(vec->elements, sizeof(intptr_t) * vec->allocatedElements, vec->alignment);
+	} else {
+		vec->elements = mem_Realloc(vec->elements, sizeof(intptr_t) * vec->allocatedElements);
+	}
 }
 
 extern vec_t*
@@ -51,6 +61,8 @@ vec_CreateLength(free_t free, size_t size) {
 	vec_t* vec = (vec_t*) mem_Alloc(sizeof(vec_t));
 #endif
 	vec->refCount = 0;
+	vec->arena = NULL;
+	vec->alignment = 0;
 	vec->free = free;
 	vec->userData = 0;
 	vec->allocatedElements = size == 0 ? 1 : (uint32_t) size;
@@ -64,6 +76,45 @@ vec_CreateLength(free_t free, size_t size) {
 	return vec;
 }
 
+extern vec_t*
+vec_CreateLengthArena(mem_arena_t* arena, free_t free, size_t size) {
+	vec_t* vec = (vec_t*) mem_ArenaAlloc(arena, sizeof(vec_t));
+	vec->refCount = 0;
+	vec->arena = arena;
+	vec->alignment = 0;
+	vec->free = free;
+	vec->userData = 0;
+	vec->allocatedElements = size == 0 ? 1 : (uint32_t) size;
+	vec->totalElements = 0;
+	vec->elements = mem_ArenaAlloc(arena, sizeof(intptr_t) * vec->allocatedElements);
+
+	return vec;
+}
+
+extern vec_t*
+#if defined(_DEBUG)
+vec_CreateLengthAlignedDebug(free_t free, size_t size, size_t alignment, const char* filename, int lineNumber) {
+	vec_t* vec = (vec_t*) mem_AllocImpl(sizeof(vec_t), filename, lineNumber);
+#else
+vec_CreateLengthAligned(free_t free, size_t size, size_t alignment) {
+	vec_t* vec = (vec_t*) mem_Alloc(sizeof(vec_t));
+#endif
+	vec->refCount = 0;
+	vec->arena = NULL;
+	vec->alignment = (uint32_t) alignment;
+	vec->free = free;
+	vec->userData = 0;
+	vec->allocatedElements = size == 0 ? 1 : (uint32_t) size;
+	vec->totalElements = 0;
+#if defined(_DEBUG)
+	vec->elements = mem_AllocAlignedImpl(sizeof(intptr_t) * vec->allocatedElements, alignment, filename, lineNumber);
+#else
+	vec->elements = mem_AllocAligned(sizeof(intptr_t) * vec->allocatedElements, alignment);
+#endif
+
+	return vec;
+}
+
 extern void
 vec_PushBack(vec_t* vec, intptr_t element) {
 	assert(!vec_Frozen(vec));
@@ -101,8 +152,13 @@ vec_Free(vec_t* vec) {
 		for (uint32_t i = 0; i < vec->totalElements; ++i) {
 			vec->free(vec->userData, vec->elements[i]);
 		}
-		mem_Free(vec->elements);
-		mem_Free(vec);
+		if (vec->arena == NULL) {
+			if (vec->alignment != 0)
+				mem_FreeAligned(vec->elements);
+			else
+				mem_Free(vec->elements);
+			mem_Free(vec);
+		}
 	}
 }
 
@@ -126,6 +182,12 @@ vec_ElementAt(vec_t* vec, size_t index) {
 	return vec->elements[index];
 }
 
+extern intptr_t*
+vec_Elements(vec_t* vec) {
+	assert(vec != NULL);
+	return vec->elements;
+}
+
 extern intptr_t
 vec_SetAt(vec_t* vec, size_t index, intptr_t element) {
 	assert(vec != NULL);
@@ -178,7 +240,14 @@ vec_Copy(vec_t* vec, copy_t copy) {
 			return vec;
 		}
 
-		vec_t* dest = vec_CreateLength(vec->free, vec->totalElements);
+		vec_t* dest;
+		if (vec->arena != NULL)
+			dest = vec_CreateLengthArena(vec->arena, vec->free, vec->totalElements);
+		else if (vec->alignment != 0)
+			dest = vec_CreateLengthAligned(vec->free, vec->totalElements, vec->alignment);
+		else
+			dest = vec_CreateLength(vec->free, vec->totalElements);
+
 		for (size_t i = 0; i < vec_Count(vec); ++i) {
 			vec_PushBack(dest, copy(vec->userData, vec_ElementAt(vec, i)));
 		}
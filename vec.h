@@ -22,6 +22,7 @@
 #include <stdint.h>
 #include <stdlib.h>
 
+#include "mem.h"
 #include "protos.h"
 #include "util.h"
 
@@ -49,6 +50,25 @@ vec_Create(free_t free) {
 #endif
 }
 
+/* Create a vector whose control block and element storage are allocated from an arena */
+extern vec_t*
+vec_CreateLengthArena(mem_arena_t* arena, free_t free, size_t size);
+
+INLINE vec_t*
+vec_CreateArena(mem_arena_t* arena, free_t free) {
+	return vec_CreateLengthArena(arena, free, 16);
+}
+
+/* Create a vector whose element storage is aligned to a power of two, see vec_Elements */
+extern vec_t*
+#if defined(_DEBUG)
+vec_CreateLengthAlignedDebug(free_t free, size_t size, size_t alignment, const char* filename, int lineNumber);
+#define vec_CreateLengthAligned(free, size, alignment) \
+	vec_CreateLengthAlignedDebug(free, size, alignment, __FILE__, __LINE__)
+#else
+vec_CreateLengthAligned(free_t free, size_t size, size_t alignment);
+#endif
+
 extern void
 vec_PushBack(vec_t* vec, intptr_t element);
 
@@ -70,6 +90,10 @@ vec_InsertAt(vec_t* vec, size_t index, intptr_t element);
 extern intptr_t
 vec_ElementAt(vec_t* vec, size_t index);
 
+/* The element storage. It is only valid until the vector is next modified. */
+extern intptr_t*
+vec_Elements(vec_t* vec);
+
 extern intptr_t
 vec_SetAt(vec_t* vec, size_t index, intptr_t element);
 